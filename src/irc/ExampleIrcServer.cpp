@@ -23,8 +23,9 @@ void ExampleIrcServer::echo(const QString &text)
 }
 
 
-void ExampleIrcServer::privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text)
+bool ExampleIrcServer::privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text)
 {
+    return false;
 }
 
 
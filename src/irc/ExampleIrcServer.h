@@ -19,7 +19,7 @@ public slots:
 private slots:
 
 private:
-    void privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text);
+    bool privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text);
     void echo(const QString& text);
 };
 
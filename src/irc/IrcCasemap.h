@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QString>
+
+/*
+ * Fold a nickname or channel name with RFC 1459 casemapping, for use as a
+ * lookup key: A-Z become a-z, and []\~ become {}|^ (their lower case forms
+ * in the Scandinavian character set IRC inherited).
+ */
+inline QString ircCaseFold(const QString& name)
+{
+    QString folded = name;
+    for(QChar& c : folded)
+    {
+        const char16_t u = c.unicode();
+        if(u >= u'A' && u <= u'Z')
+        {
+            c = QChar(static_cast<char16_t>(u + (u'a' - u'A')));
+        }
+        else if(u == u'[')
+        {
+            c = QLatin1Char('{');
+        }
+        else if(u == u']')
+        {
+            c = QLatin1Char('}');
+        }
+        else if(u == u'\\')
+        {
+            c = QLatin1Char('|');
+        }
+        else if(u == u'~')
+        {
+            c = QLatin1Char('^');
+        }
+    }
+    return folded;
+}
@@ -31,6 +31,7 @@
  */
 #include "IrcChannel.h"
 #include "IrcUser.h"
+#include "IrcCasemap.h"
 
 IrcChannel::IrcChannel(QObject *parent, const QString& name) :
     QObject(parent),
@@ -42,6 +43,7 @@ IrcChannel::IrcChannel(QObject *parent, const QString& name) :
 void IrcChannel::addMember(IrcUser *user, const QString& flags)
 {
     members.insert(user, flags);
+    members_by_nick.insert(ircCaseFold(user->nick), user);
 }
 
 QList<IrcUser*> IrcChannel::getMembers()
@@ -100,20 +102,34 @@ bool IrcChannel::hasMember(const QString& nickname)
 
 IrcUser* IrcChannel::getMember(const QString& nickname)
 {
-    foreach(IrcUser* member, members.keys())
-    {
-        if(member->nick == nickname)
-        {
-            return member;
-        }
-    }
-    return NULL;
+    return members_by_nick.value(ircCaseFold(nickname), NULL);
 }
 
 void IrcChannel::removeMember(IrcUser* member)
 {
     emit part(member);
     members.remove(member);
+
+    auto it = members_by_nick.find(ircCaseFold(member->nick));
+    if(it != members_by_nick.end() && it.value() == member)
+    {
+        members_by_nick.erase(it);
+    }
+}
+
+void IrcChannel::memberRenamed(IrcUser* member, const QString& old_nick)
+{
+    if(!members.contains(member))
+    {
+        return;
+    }
+
+    auto it = members_by_nick.find(ircCaseFold(old_nick));
+    if(it != members_by_nick.end() && it.value() == member)
+    {
+        members_by_nick.erase(it);
+    }
+    members_by_nick.insert(ircCaseFold(member->nick), member);
 }
 
 void IrcChannel::setTopic(IrcUser* sender, const QString& topic)
@@ -59,6 +59,9 @@ public:
 
     void removeMember(IrcUser* member);
 
+    // keep the nick index in step after member's nick changed from old_nick
+    void memberRenamed(IrcUser* member, const QString& old_nick);
+
     void setTopic(IrcUser* sender, const QString& topic);
     const QString& getTopic();
 
@@ -70,6 +73,8 @@ signals:
 private:
     // {user: flags, ...}
     QHash<IrcUser*, QString> members;
+    // {case folded nick: user, ...}
+    QHash<QString, IrcUser*> members_by_nick;
     QString topic;
 
 };
@@ -50,29 +50,77 @@ static const QRegularExpression re_realname (
 static const QRegularExpression re_channel (
         QStringLiteral("^[&#+!][^\\x00\\x07\\x0a\\x0d ,:]{0,50}$"));
 
-static const QRegularExpression re_message (
-        QStringLiteral("^(?<prefix>:[^ ]+)? ?(?<command>[^ ]+) ?(?<params>.+?)?(( :)(?<trailing>.*))?\r?\n?$"));
+// what CAP LS offers
+static const struct
+{
+    const char* name;
+    IrcConnection::Capability cap;
+} capabilities[] = {
+    {"batch",            IrcConnection::CapBatch},
+    {"echo-message",     IrcConnection::CapEchoMessage},
+    {"labeled-response", IrcConnection::CapLabeledResponse},
+    {"message-tags",     IrcConnection::CapMessageTags},
+    {"server-time",      IrcConnection::CapServerTime},
+};
+
+// add tag ("key=value") in front of any tags an encoded line already has
+static QByteArray addTag(const QByteArray& line, const QByteArray& tag)
+{
+    if(line.startsWith('@'))
+    {
+        return QByteArrayLiteral("@") + tag + QByteArrayLiteral(";") + line.mid(1);
+    }
+    return QByteArrayLiteral("@") + tag + QByteArrayLiteral(" ") + line;
+}
+
+static bool hasTag(const QByteArray& line, std::string_view key)
+{
+    if(!line.startsWith('@'))
+    {
+        return false;
+    }
+    const int end = line.indexOf(' ');
+    std::string_view value;
+    return IrcMessage::findTag(std::string_view(line.constData() + 1, static_cast<size_t>((end < 0 ? line.size() : end) - 1)), key, &value);
+}
 
 
 IrcConnection::IrcConnection(QObject *parent, IrcServer* server, QTcpSocket *socket, const QString& password)
     : IrcUser(parent),
       server(server),
       socket(socket),
+      io_pool(server->ioThreadPool()),
+      local_hostname(socket->localAddress().toString()),
+      link_closed(false),
+      disconnect_emitted(false),
+      flush_scheduled(false),
+      sendq_exceeded(false),
       password(password),
+      caps(0),
+      cap_negotiating(false),
+      labeling(false),
       have_nick(false),
       have_user(false),
       have_pass(false),
       welcome_sent(false)
 {
-    hostname = socket->localAddress().toString();
-    buffer = new QByteArray();
+    hostname = local_hostname;
     configureHandlers();
-    connect(socket,
-            SIGNAL(readyRead()),
-            SLOT(readyRead()));
-    connect(socket,
-            SIGNAL(disconnected()),
-            SLOT(disconnected()));
+    if(io_pool != Q_NULLPTR)
+    {
+        this->socket = Q_NULLPTR;
+        io_link = io_pool->attach(socket);
+        io_link->connection = this;
+    }
+    else
+    {
+        connect(socket,
+                SIGNAL(readyRead()),
+                SLOT(readyRead()));
+        connect(socket,
+                SIGNAL(disconnected()),
+                SLOT(disconnected()));
+    }
 
     have_pass = password.count() == 0 ? true : false;
 }
@@ -80,47 +128,92 @@ IrcConnection::IrcConnection(QObject *parent, IrcServer* server, QTcpSocket *soc
 
 IrcConnection::~IrcConnection()
 {
+    if(io_link)
+    {
+        if(!link_closed)
+        {
+            io_pool->close(io_link);
+        }
+        io_link->connection = Q_NULLPTR;
+    }
     disconnected();
 }
 
 
-QTcpSocket* IrcConnection::getSocket() const {
-    return socket;
-}
-
-
 void IrcConnection::readyRead()
 {
-    while (socket->bytesAvailable() > 0)
+    if(link_closed)
     {
-        buffer->append(socket->readAll());
+        return;
     }
+    reader.read(socket,
+        [this](std::string_view line) -> bool
+        {
+            handleLine(line);
+            // handlers may close the link, after which we stop reading
+            return !link_closed;
+        },
+        [this]()
+        {
+            inputTooLong();
+        });
+}
 
-    QString data = QString::fromUtf8(*buffer);
-    buffer->clear();
 
-    QStringList lines = data.split(QStringLiteral("\r\n"), Qt::SkipEmptyParts);
-    foreach(const QString& line, lines)
+void IrcConnection::disconnected()
+{
+    link_closed = true;
+    output.clear();
+    labeling = false;
+    labeled_lines.clear();
+    if(!disconnect_emitted)
     {
-        handleLine(line);
+        disconnect_emitted = true;
+        emit disconnect(this);
     }
 }
 
 
-void IrcConnection::disconnected()
+void IrcConnection::ioEvent(const IrcIoThreadPool::Event& event)
 {
-    if(buffer != Q_NULLPTR)
+    switch(event.type)
     {
-        delete buffer;
+    case IrcIoThreadPool::Event::Type::Command:
+        if(!link_closed)
+        {
+            handleCommand(event.command, event.params,
+                          std::string_view(event.tags.constData(), static_cast<size_t>(event.tags.size())));
+        }
+        break;
+    case IrcIoThreadPool::Event::Type::LineTooLong:
+        if(!link_closed)
+        {
+            inputTooLong();
+        }
+        break;
+    case IrcIoThreadPool::Event::Type::InvalidLine:
+        if(!link_closed)
+        {
+            qWarning() << "invalid data received, disconnecting";
+            closeLink();
+        }
+        break;
+    case IrcIoThreadPool::Event::Type::Disconnected:
+        disconnected();
+        break;
     }
-    buffer = Q_NULLPTR;
-    emit disconnect(this);
+}
+
+
+void IrcConnection::inputTooLong()
+{
+    reply(ERR_INPUTTOOLONG, QStringLiteral("%1 :Input line was too long").arg(nick));
 }
 
 
 QString IrcConnection::getLocalHostname()
 {
-    return socket->localAddress().toString();
+    return local_hostname;
 }
 
 
@@ -138,22 +231,226 @@ void IrcConnection::reply(const QString& text)
 
 void IrcConnection::reply(const QString& prefix, const QString& text)
 {
-    QString out_str;
-    QByteArray out_bytes;
+    send(encodeLine(prefix, text));
+}
+
+
+QByteArray IrcConnection::encodeLine(const QString& prefix, const QString& text)
+{
+    QByteArray line;
+    line.reserve(prefix.size() + text.size() + 4);
+    line.append(':');
+    line.append(prefix.toUtf8());
+    line.append(' ');
+    line.append(text.toUtf8());
+    line.append("\r\n", 2);
+    return line;
+}
+
+
+bool IrcConnection::hasCapability(Capability cap) const
+{
+    return (caps & cap) != 0;
+}
+
+
+void IrcConnection::sendTagged(const QByteArray& line, const QString& batch, const QString& time, const QString& msgid)
+{
+    QByteArray tags;
+    auto add = [&tags](const char* key, const QString& value)
+    {
+        if(!tags.isEmpty())
+        {
+            tags.append(';');
+        }
+        tags.append(key).append('=').append(value.toUtf8());
+    };
+    if(!batch.isEmpty() && hasCapability(CapBatch))
+    {
+        add("batch", batch);
+    }
+    if(!time.isEmpty() && hasCapability(CapServerTime))
+    {
+        add("time", time);
+    }
+    if(!msgid.isEmpty() && hasCapability(CapMessageTags))
+    {
+        add("msgid", msgid);
+    }
+
+    send(tags.isEmpty() ? line : QByteArrayLiteral("@") + tags + QByteArrayLiteral(" ") + line);
+}
+
+
+QString IrcConnection::serverTime(qint64 msecs)
+{
+    return QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC).toString(Qt::ISODateWithMs);
+}
+
+
+void IrcConnection::echoMessage(const QString& msgtarget, const QString& text)
+{
+    if(hasCapability(CapEchoMessage))
+    {
+        sendTagged(encodeLine(getPrefix(), QStringLiteral("PRIVMSG %1 :%2").arg(msgtarget).arg(text)),
+                   QString(),
+                   serverTime(QDateTime::currentMSecsSinceEpoch()));
+    }
+}
+
+
+QString IrcConnection::beginBatch(const QString& type, const QString& params)
+{
+    if(!hasCapability(CapBatch))
+    {
+        return QString();
+    }
+    const QString batch = server->nextBatchRef();
+    reply(QStringLiteral("BATCH +%1 %2 %3").arg(batch).arg(type).arg(params));
+    return batch;
+}
 
-    out_str = QStringLiteral(":%1 %2\r\n").arg(prefix).arg(text);
-    out_bytes = out_str.toUtf8();
-    socket->write(out_bytes.constData(), out_bytes.length());
-    socket->flush();
-    qDebug() << "SEND:" << out_str;
+
+void IrcConnection::endBatch(const QString& batch)
+{
+    if(!batch.isEmpty())
+    {
+        reply(QStringLiteral("BATCH -%1").arg(batch));
+    }
+}
+
+
+void IrcConnection::finishLabeledResponse()
+{
+    if(!labeling)
+    {
+        return;
+    }
+    labeling = false;
+
+    QList<QByteArray> lines;
+    lines.swap(labeled_lines);
+    const QByteArray label = QByteArrayLiteral("label=") + response_label;
+
+    if(lines.isEmpty())
+    {
+        send(addTag(encodeLine(getLocalHostname(), QStringLiteral("ACK")), label));
+    }
+    else if(lines.size() == 1 || !hasCapability(CapBatch))
+    {
+        send(addTag(lines.takeFirst(), label));
+        for(const QByteArray& line : lines)
+        {
+            send(line);
+        }
+    }
+    else
+    {
+        const QString batch = server->nextBatchRef();
+        const QByteArray batchTag = QByteArrayLiteral("batch=") + batch.toUtf8();
+        send(addTag(encodeLine(getLocalHostname(), QStringLiteral("BATCH +%1 labeled-response").arg(batch)), label));
+        for(const QByteArray& line : lines)
+        {
+            // lines of a batch nested in this one already name theirs
+            send(hasTag(line, "batch") ? line : addTag(line, batchTag));
+        }
+        send(encodeLine(getLocalHostname(), QStringLiteral("BATCH -%1").arg(batch)));
+    }
 }
 
 
 void IrcConnection::reply(IrcReplies command, const QString& text)
 {
-    QString cmd;
-    cmd.sprintf("%03d", command);
-    reply(QStringLiteral("%1 %2").arg(cmd).arg(text));
+    reply(QStringLiteral("%1 %2").arg(static_cast<int>(command), 3, 10, QLatin1Char('0')).arg(text));
+}
+
+
+void IrcConnection::send(const QByteArray& line)
+{
+    if(labeling)
+    {
+        labeled_lines.append(line);
+        return;
+    }
+    if(sendq_exceeded || link_closed)
+    {
+        return;
+    }
+
+    // a client that stops reading must not make us buffer without bound
+    const qint64 limit = server->sendQueueLimit();
+    const qint64 unsent = io_link ? io_link->pendingBytes.load() : socket->bytesToWrite();
+    if(limit > 0 && output.size() + unsent + line.size() > limit)
+    {
+        qWarning() << "SendQ exceeded for" << nick << "- disconnecting";
+        sendq_exceeded = true;
+        output.clear();
+        const QByteArray error = QByteArrayLiteral("ERROR :Closing Link: SendQ exceeded\r\n");
+        if(io_link)
+        {
+            io_pool->write(io_link, error);
+            io_pool->abort(io_link);
+        }
+        else
+        {
+            socket->write(error);
+            // don't disconnect from within whatever is replying to us
+            QMetaObject::invokeMethod(socket, &QAbstractSocket::abort, Qt::QueuedConnection);
+        }
+        return;
+    }
+
+    output.append(line);
+    if(!flush_scheduled)
+    {
+        flush_scheduled = true;
+        QMetaObject::invokeMethod(this, [this]() {
+            flush_scheduled = false;
+            flushOutput();
+        }, Qt::QueuedConnection);
+    }
+}
+
+
+void IrcConnection::flushOutput()
+{
+    if(output.isEmpty())
+    {
+        return;
+    }
+    if(link_closed)
+    {
+        // nothing to write to anymore
+    }
+    else if(io_link)
+    {
+        io_pool->write(io_link, output);
+    }
+    else if(socket->state() == QAbstractSocket::ConnectedState)
+    {
+        socket->write(output);
+    }
+    output.clear();
+}
+
+
+void IrcConnection::closeLink()
+{
+    if(link_closed)
+    {
+        return;
+    }
+    finishLabeledResponse();
+    flushOutput();
+    link_closed = true;
+    if(io_link)
+    {
+        io_pool->close(io_link);
+    }
+    else
+    {
+        socket->close();
+    }
 }
 
 
@@ -165,70 +462,85 @@ bool IrcConnection::isLoggedIn()
 
 void IrcConnection::checkLogin()
 {
-    if(isLoggedIn() && !welcome_sent) {
+    if(isLoggedIn() && !welcome_sent && !cap_negotiating) {
         reply(RPL_WELCOME, QStringLiteral("%1 :%2")
               .arg(nick)
               .arg(server->getWelcomeMessage()));
         reply(RPL_YOURHOST, QStringLiteral("%1 :Your host is: %2")
               .arg(nick)
               .arg(getLocalHostname()));
+        const QStringList isupport = server->isupportTokens();
+        if(!isupport.isEmpty())
+        {
+            reply(RPL_ISUPPORT, QStringLiteral("%1 %2 :are supported by this server")
+                  .arg(nick)
+                  .arg(isupport.join(QLatin1Char(' '))));
+        }
         emit loggedIn();
         welcome_sent = true;
     }
 }
 
-void IrcConnection::handleLine(const QString& line)
+void IrcConnection::handleLine(std::string_view line)
 {
-    qDebug() << "RECV:" << line;
-    QRegularExpressionMatch match = re_message.match(line);
-    if(!match.hasMatch())
+    qDebug() << "RECV:" << QByteArray::fromRawData(line.data(), static_cast<int>(line.size()));
+    if(!message.parse(line))
     {
         qWarning() << "invalid data received, disconnecting";
-        socket->close();
+        closeLink();
         return;
     }
 
-    QString prefix = match.captured(QStringLiteral("prefix"));
-    QString command = match.captured(QStringLiteral("command"));
-    QList<QString> params = match.captured(QStringLiteral("params")).split(QStringLiteral(" "));
-    QString trailing = match.captured(QStringLiteral("trailing"));
-    if(trailing.count())
+    handleCommand(QByteArray::fromRawData(message.command.data(), static_cast<int>(message.command.size())),
+                  ircMessageParams(message),
+                  message.tags);
+}
+
+
+void IrcConnection::handleCommand(const QByteArray& command, const QList<QString>& params, std::string_view tags)
+{
+    auto it = command_funcs.constFind(command);
+    if(it == command_funcs.constEnd())
     {
-        params.append(trailing);
+        qDebug() << "unknown IRC command: " << command;
+        return;
     }
 
-    if(command_funcs.contains(command))
+    // capability negotiation usually comes first, before PASS
+    if(!have_pass && command != "PASS" && command != "CAP")
     {
-        if(!have_pass && command != QStringLiteral("PASS"))
-        {
-            reply(ERR_NOTREGISTERED, QStringLiteral("User cannot proceed without a password."));
-        }
-        else
-        {
-            command_funcs[command](params);
-        }
+        reply(ERR_NOTREGISTERED, QStringLiteral("User cannot proceed without a password."));
+        return;
     }
-    else
+
+    std::string_view label;
+    if(hasCapability(CapLabeledResponse) && IrcMessage::findTag(tags, "label", &label) && !label.empty())
     {
-        qDebug() << "unknown IRC command: " << command;
+        response_label = QByteArray(label.data(), static_cast<int>(label.size()));
+        labeling = true;
     }
+
+    (*it)(params);
+    finishLabeledResponse();
 }
 
 
 void IrcConnection::configureHandlers()
 {
-    command_funcs.insert(QStringLiteral("PASS"), [this](QList<QString> params)    { this->handle_PASS(params); });
-    command_funcs.insert(QStringLiteral("NICK"), [this](QList<QString> params)    { this->handle_NICK(params); });
-    command_funcs.insert(QStringLiteral("USER"), [this](QList<QString> params)    { this->handle_USER(params); });
-    command_funcs.insert(QStringLiteral("JOIN"), [this](QList<QString> params)    { this->handle_JOIN(params); });
-    command_funcs.insert(QStringLiteral("PING"), [this](QList<QString> params)    { this->handle_PING(params); });
-    command_funcs.insert(QStringLiteral("PRIVMSG"), [this](QList<QString> params) { this->handle_PRIVMSG(params); });
-    command_funcs.insert(QStringLiteral("PART"), [this](QList<QString> params)    { this->handle_PART(params); });
-    command_funcs.insert(QStringLiteral("QUIT"), [this](QList<QString> params)    { this->handle_QUIT(params); });
+    command_funcs.insert(QByteArrayLiteral("PASS"), [this](const QList<QString>& params)    { this->handle_PASS(params); });
+    command_funcs.insert(QByteArrayLiteral("NICK"), [this](const QList<QString>& params)    { this->handle_NICK(params); });
+    command_funcs.insert(QByteArrayLiteral("USER"), [this](const QList<QString>& params)    { this->handle_USER(params); });
+    command_funcs.insert(QByteArrayLiteral("JOIN"), [this](const QList<QString>& params)    { this->handle_JOIN(params); });
+    command_funcs.insert(QByteArrayLiteral("PING"), [this](const QList<QString>& params)    { this->handle_PING(params); });
+    command_funcs.insert(QByteArrayLiteral("PRIVMSG"), [this](const QList<QString>& params) { this->handle_PRIVMSG(params); });
+    command_funcs.insert(QByteArrayLiteral("PART"), [this](const QList<QString>& params)    { this->handle_PART(params); });
+    command_funcs.insert(QByteArrayLiteral("QUIT"), [this](const QList<QString>& params)    { this->handle_QUIT(params); });
+    command_funcs.insert(QByteArrayLiteral("CHATHISTORY"), [this](const QList<QString>& params) { this->handle_CHATHISTORY(params); });
+    command_funcs.insert(QByteArrayLiteral("CAP"), [this](const QList<QString>& params)     { this->handle_CAP(params); });
 }
 
 
-void IrcConnection::handle_PASS(QList<QString> params)
+void IrcConnection::handle_PASS(const QList<QString>& params)
 {
     if(params.size() < 1)
     {
@@ -245,7 +557,7 @@ void IrcConnection::handle_PASS(QList<QString> params)
         else
         {
             reply(ERR_PASSWDMISMATCH, QStringLiteral("Invalid password."));
-            socket->close();
+            closeLink();
             return;
         }
     }
@@ -253,7 +565,7 @@ void IrcConnection::handle_PASS(QList<QString> params)
 }
 
 
-void IrcConnection::handle_NICK(QList<QString> params)
+void IrcConnection::handle_NICK(const QList<QString>& params)
 {
     if(params.size() < 1)
     {
@@ -274,7 +586,7 @@ void IrcConnection::handle_NICK(QList<QString> params)
 }
 
 
-void IrcConnection::handle_USER(QList<QString> params)
+void IrcConnection::handle_USER(const QList<QString>& params)
 {
     if(params.size() < 4)
     {
@@ -284,13 +596,13 @@ void IrcConnection::handle_USER(QList<QString> params)
     if(!re_user.match(params[0]).hasMatch())
     {
         reply(ERR_UNKNOWNCOMMAND, QStringLiteral("Invalid user name."));
-        socket->close();
+        closeLink();
         return;
     }
     if(!re_realname.match(params[3]).hasMatch())
     {
         reply(ERR_UNKNOWNCOMMAND, QStringLiteral("Invalid real name."));
-        socket->close();
+        closeLink();
         return;
     }
     this->user = params[0];
@@ -300,7 +612,7 @@ void IrcConnection::handle_USER(QList<QString> params)
 }
 
 
-void IrcConnection::handle_JOIN(QList<QString> params)
+void IrcConnection::handle_JOIN(const QList<QString>& params)
 {
     if(params.size() < 1)
     {
@@ -316,7 +628,7 @@ void IrcConnection::handle_JOIN(QList<QString> params)
 }
 
 
-void IrcConnection::handle_PRIVMSG(QList<QString> params)
+void IrcConnection::handle_PRIVMSG(const QList<QString>& params)
 {
     if(params.size() < 2)
     {
@@ -328,11 +640,18 @@ void IrcConnection::handle_PRIVMSG(QList<QString> params)
         reply(ERR_NOLOGIN, QStringLiteral("Access prohibited."));
         return;
     }
+    // an empty trailing parameter is still a parameter, but there's nothing to send
+    if(params[1].isEmpty())
+    {
+        reply(ERR_NOTEXTTOSEND, QStringLiteral("%1 :No text to send").arg(nick));
+        return;
+    }
+    // the server echoes it back once it was delivered
     emit privmsg(this, params[0], params[1]);
 }
 
 
-void IrcConnection::handle_PART(QList<QString> params)
+void IrcConnection::handle_PART(const QList<QString>& params)
 {
     if(params.size() < 1)
     {
@@ -353,20 +672,114 @@ void IrcConnection::handle_PART(QList<QString> params)
 }
 
 
-void IrcConnection::handle_PING(QList<QString> params)
+void IrcConnection::handle_PING(const QList<QString>& params)
 {
     (void)params;
     reply(QStringLiteral("PONG %1 :%2").arg(getLocalHostname()).arg(getLocalHostname()));
 }
 
 
-void IrcConnection::handle_QUIT(QList<QString> params)
+void IrcConnection::handle_QUIT(const QList<QString>& params)
 {
     (void)params;
     emit quit(this);
 }
 
 
+void IrcConnection::handle_CHATHISTORY(const QList<QString>& params)
+{
+    if(!isLoggedIn())
+    {
+        reply(ERR_NOTREGISTERED, QStringLiteral("You have not registered"));
+        return;
+    }
+    server->chatHistory(this, params);
+}
+
+
+void IrcConnection::handle_CAP(const QList<QString>& params)
+{
+    const QString target = nick.isEmpty() ? QStringLiteral("*") : nick;
+    if(params.size() < 1)
+    {
+        reply(ERR_NEEDMOREPARAMS, QStringLiteral("%1 CAP :Not enough parameters").arg(target));
+        return;
+    }
+
+    const QString subcommand = params[0].toUpper();
+    if(subcommand == QLatin1String("LS") || subcommand == QLatin1String("LIST"))
+    {
+        const bool list = subcommand == QLatin1String("LIST");
+        if(!list && !welcome_sent)
+        {
+            cap_negotiating = true;
+        }
+        QStringList names;
+        for(const auto& capability : capabilities)
+        {
+            if(!list || hasCapability(capability.cap))
+            {
+                names << QLatin1String(capability.name);
+            }
+        }
+        reply(QStringLiteral("CAP %1 %2 :%3").arg(target).arg(subcommand).arg(names.join(QLatin1Char(' '))));
+    }
+    else if(subcommand == QLatin1String("REQ"))
+    {
+        if(params.size() < 2)
+        {
+            reply(ERR_NEEDMOREPARAMS, QStringLiteral("%1 CAP :Not enough parameters").arg(target));
+            return;
+        }
+        if(!welcome_sent)
+        {
+            cap_negotiating = true;
+        }
+
+        // the whole request is accepted or none of it is
+        quint32 enable = 0, disable = 0;
+        bool known = true;
+        for(const QString& token : params[1].split(QLatin1Char(' '), Qt::SkipEmptyParts))
+        {
+            const bool remove = token.startsWith(QLatin1Char('-'));
+            const QString name = remove ? token.mid(1) : token;
+            quint32 cap = 0;
+            for(const auto& capability : capabilities)
+            {
+                if(name == QLatin1String(capability.name))
+                {
+                    cap = capability.cap;
+                }
+            }
+            if(cap == 0)
+            {
+                known = false;
+                break;
+            }
+            (remove ? disable : enable) |= cap;
+        }
+
+        if(known)
+        {
+            caps = (caps | enable) & ~disable;
+        }
+        reply(QStringLiteral("CAP %1 %2 :%3").arg(target).arg(known ? QStringLiteral("ACK") : QStringLiteral("NAK")).arg(params[1]));
+    }
+    else if(subcommand == QLatin1String("END"))
+    {
+        if(cap_negotiating)
+        {
+            cap_negotiating = false;
+            checkLogin();
+        }
+    }
+    else
+    {
+        reply(ERR_INVALIDCAPCMD, QStringLiteral("%1 %2 :Invalid CAP command").arg(target).arg(params[0]));
+    }
+}
+
+
 void IrcConnection::join(const QString& channel_name)
 {
     QRegularExpressionMatch match = re_channel.match(channel_name);
@@ -36,8 +36,13 @@
 #include <QTcpSocket>
 #include <QByteArray>
 #include <functional>
+#include <memory>
+#include <string_view>
 #include "IrcUser.h"
 #include "IrcConstants.h"
+#include "IrcIoThreadPool.h"
+#include "IrcLineReader.h"
+#include "IrcMessage.h"
 
 class IrcServer;
 class IrcChannel;
@@ -46,10 +51,24 @@ class IrcConnection : public IrcUser
 {
     Q_OBJECT
 public:
+    /**
+     * @brief takes over socket; if the server has an I/O thread pool the
+     * socket is moved onto one of its threads
+     */
     explicit IrcConnection(QObject *parent, IrcServer* server, QTcpSocket* socket, const QString& password = QStringLiteral(""));
     ~IrcConnection();
 
-    QTcpSocket* getSocket() const;
+    // IRCv3 capabilities a client can enable with CAP REQ
+    enum Capability : quint32
+    {
+        CapBatch           = 1 << 0,
+        CapEchoMessage     = 1 << 1,
+        CapLabeledResponse = 1 << 2,
+        CapMessageTags     = 1 << 3,
+        CapServerTime      = 1 << 4,
+    };
+
+    bool hasCapability(Capability cap) const;
 
     void reply(const QString& text);
 
@@ -57,12 +76,51 @@ public:
 
     void reply(IrcReplies command, const QString& text);
 
+    /**
+     * @brief queue a complete, already encoded line (including its CRLF)
+     * Queued output is written to the socket once control returns to the
+     * event loop.
+     */
+    void send(const QByteArray& line);
+
+    /**
+     * @brief encode ":prefix text\r\n" for send()
+     * Messages going to many connections should be encoded once and the
+     * result sent to each of them; QByteArray shares the encoded bytes.
+     */
+    static QByteArray encodeLine(const QString& prefix, const QString& text);
+
+    /**
+     * @brief send() an encoded line with whichever of these tags the client
+     * enabled; empty arguments are left out
+     * @param batch reference from beginBatch() (batch)
+     * @param time from serverTime() (server-time)
+     * @param msgid (message-tags)
+     */
+    void sendTagged(const QByteArray& line, const QString& batch, const QString& time = QString(), const QString& msgid = QString());
+
+    // format milliseconds since the epoch for the server-time tag
+    static QString serverTime(qint64 msecs);
+
+    // send a delivered PRIVMSG back to its sender, if the client enabled echo-message
+    void echoMessage(const QString& msgtarget, const QString& text);
+
+    /**
+     * @brief start a BATCH of the given type, if the client enabled batch
+     * @return reference for the batch's lines and endBatch(); empty if no batch was started
+     */
+    QString beginBatch(const QString& type, const QString& params);
+    void endBatch(const QString& batch);
+
     void join(const QString& channel_name);
 
     void messageChannel(const QString& command, const QString& text);
 
     bool isLoggedIn();
 
+    // send anything still queued, then close the socket
+    void closeLink();
+
 signals:
     void loggedIn();
     void joined(IrcUser* user, const QString& channel);
@@ -76,29 +134,69 @@ public slots:
     void disconnected();
 
 private:
+    friend class IrcIoThreadPool;
+
     IrcServer *server;
+    // the socket, when its I/O runs on this thread
     QTcpSocket *socket;
-    QByteArray *buffer;
+    // otherwise the link to the pool thread that owns it
+    IrcIoThreadPool *io_pool;
+    std::shared_ptr<IrcIoLink> io_link;
+    // socket->localAddress(), which is no longer reachable once on another thread
+    QString local_hostname;
+
+    IrcLineReader reader;
+    // set once we closed the link or the client went away; input is ignored from then on
+    bool link_closed;
+    bool disconnect_emitted;
+
+    // replies waiting to be written to the socket
+    QByteArray output;
+    bool flush_scheduled;
+    // set once the client fell too far behind; nothing more is sent
+    bool sendq_exceeded;
+    void flushOutput();
+
+    // delivered by io_pool on this thread
+    void ioEvent(const IrcIoThreadPool::Event& event);
 
     QString password;
 
+    // enabled Capability flags
+    quint32 caps;
+    // registration is held until CAP END once a client starts negotiating
+    bool cap_negotiating;
+
+    // labeled-response: replies to a labeled command are collected, then sent together
+    bool labeling;
+    QByteArray response_label;
+    QList<QByteArray> labeled_lines;
+    void finishLabeledResponse();
+
     QString getLocalHostname();
     IrcServer* getIrcServer();
 
     bool have_nick, have_user, have_pass, welcome_sent;
     void checkLogin();
 
-    void handleLine(const QString& line);
+    // line is a single UTF-8 encoded message without its line terminator
+    void handleLine(std::string_view line);
+    void handleCommand(const QByteArray& command, const QList<QString>& params, std::string_view tags);
+    void inputTooLong();
     void configureHandlers();
-    QHash<QString, std::function<void(QList<QString>)>> command_funcs;
-    void handle_PASS(QList<QString> params);
-    void handle_NICK(QList<QString> params);
-    void handle_USER(QList<QString> params);
-    void handle_JOIN(QList<QString> params);
-    void handle_PING(QList<QString> params);
-    void handle_PRIVMSG(QList<QString> params);
-    void handle_PART(QList<QString> params);
-    void handle_QUIT(QList<QString> params);
+    // reused between lines so parsing doesn't allocate
+    IrcMessage message;
+    QHash<QByteArray, std::function<void(const QList<QString>&)>> command_funcs;
+    void handle_PASS(const QList<QString>& params);
+    void handle_NICK(const QList<QString>& params);
+    void handle_USER(const QList<QString>& params);
+    void handle_JOIN(const QList<QString>& params);
+    void handle_PING(const QList<QString>& params);
+    void handle_PRIVMSG(const QList<QString>& params);
+    void handle_PART(const QList<QString>& params);
+    void handle_QUIT(const QList<QString>& params);
+    void handle_CHATHISTORY(const QList<QString>& params);
+    void handle_CAP(const QList<QString>& params);
 };
 
 #endif // IRCCONNECTION_H
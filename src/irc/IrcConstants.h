@@ -38,6 +38,7 @@ enum IrcReplies {
     RPL_CREATED           =   3,
     RPL_MYINFO            =   4,
     RPL_BOUNCE            =   5,
+    RPL_ISUPPORT          =   5,
     RPL_USERHOST          = 302,
     RPL_ISON              = 303,
     RPL_AWAY              = 301,
@@ -126,11 +127,13 @@ enum IrcReplies {
     ERR_TOOMANYTARGETS    = 407,
     ERR_NOSUCHSERVICE     = 408,
     ERR_NOORIGIN          = 409,
+    ERR_INVALIDCAPCMD     = 410,
     ERR_NORECIPIENT       = 411,
     ERR_NOTEXTTOSEND      = 412,
     ERR_NOTOPLEVEL        = 413,
     ERR_WILDTOPLEVEL      = 414,
     ERR_BADMASK           = 415,
+    ERR_INPUTTOOLONG      = 417,
     ERR_UNKNOWNCOMMAND    = 421,
     ERR_NOMOTD            = 422,
     ERR_NOADMININFO       = 423,
@@ -0,0 +1,273 @@
+#include "IrcIoThreadPool.h"
+#include "IrcConnection.h"
+
+#include <QDebug>
+#include <QTcpSocket>
+#include <QThread>
+
+#include <algorithm>
+
+/*
+ * Owns the sockets of the links assigned to one worker thread and carries
+ * out the server thread's requests for them. Lives on that worker thread.
+ */
+class IrcIoWorker : public QObject
+{
+public:
+    explicit IrcIoWorker(IrcIoThreadPool* pool)
+    : pool(pool)
+    { }
+
+    // may be called from any thread
+    void post(IrcIoThreadPool::Request request)
+    {
+        if (requests.push(std::move(request)))
+        {
+            QMetaObject::invokeMethod(this, [this]() { processRequests(); }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    void processRequests()
+    {
+        requests.beginDrain();
+
+        IrcIoThreadPool::Request request;
+        while (requests.pop(request))
+        {
+            const auto& link = request.link;
+            switch (request.type)
+            {
+                case IrcIoThreadPool::Request::Type::Open:
+                    open(link);
+                    break;
+                case IrcIoThreadPool::Request::Type::Write:
+                    if (link->socket != nullptr && link->socket->state() == QAbstractSocket::ConnectedState)
+                    {
+                        link->socket->write(request.data);
+                    }
+                    else
+                    {
+                        releasePending(link, request.data.size());
+                    }
+                    break;
+                case IrcIoThreadPool::Request::Type::Close:
+                    if (link->socket != nullptr)
+                    {
+                        link->socket->close();
+                    }
+                    break;
+                case IrcIoThreadPool::Request::Type::Abort:
+                    if (link->socket != nullptr)
+                    {
+                        link->socket->abort();
+                    }
+                    break;
+            }
+            request = {};
+        }
+    }
+
+    void open(const std::shared_ptr<IrcIoLink>& link)
+    {
+        auto socket = link->socket;
+        socket->setParent(this);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, link]() { readyRead(link); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [link](qint64 bytes) { releasePending(link, bytes); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, link]() { disconnected(link); });
+
+        // the client may have sent something, or left, before we got here
+        readyRead(link);
+        if (link->socket != nullptr && link->socket->state() != QAbstractSocket::ConnectedState)
+        {
+            disconnected(link);
+        }
+    }
+
+    void readyRead(const std::shared_ptr<IrcIoLink>& link)
+    {
+        if (link->socket == nullptr || link->rejected)
+        {
+            return;
+        }
+
+        link->reader.read(link->socket,
+            [&](std::string_view line) -> bool
+            {
+                qDebug() << "RECV:" << QByteArray::fromRawData(line.data(), static_cast<int>(line.size()));
+
+                IrcIoThreadPool::Event event;
+                event.link = link;
+                if (!link->message.parse(line))
+                {
+                    // the server thread closes the link; ignore whatever else arrives
+                    link->rejected = true;
+                    event.type = IrcIoThreadPool::Event::Type::InvalidLine;
+                    pool->post(std::move(event));
+                    return false;
+                }
+
+                event.type = IrcIoThreadPool::Event::Type::Command;
+                event.tags = QByteArray(link->message.tags.data(), static_cast<int>(link->message.tags.size()));
+                event.command = QByteArray(link->message.command.data(), static_cast<int>(link->message.command.size()));
+                event.params = ircMessageParams(link->message);
+                pool->post(std::move(event));
+                return true;
+            },
+            [&]()
+            {
+                IrcIoThreadPool::Event event;
+                event.type = IrcIoThreadPool::Event::Type::LineTooLong;
+                event.link = link;
+                pool->post(std::move(event));
+            });
+    }
+
+    void disconnected(const std::shared_ptr<IrcIoLink>& link)
+    {
+        auto socket = link->socket;
+        if (socket == nullptr)
+        {
+            return;
+        }
+        link->socket = nullptr;
+        link->closed = true;
+        link->pendingBytes = 0;
+        socket->deleteLater();
+
+        IrcIoThreadPool::Event event;
+        event.type = IrcIoThreadPool::Event::Type::Disconnected;
+        event.link = link;
+        pool->post(std::move(event));
+    }
+
+    // a write queued just before the link closed may be released after
+    // disconnected() reset the count, so never go below zero
+    static void releasePending(const std::shared_ptr<IrcIoLink>& link, qint64 bytes)
+    {
+        qint64 pending = link->pendingBytes.load();
+        while (!link->pendingBytes.compare_exchange_weak(pending, std::max<qint64>(pending - bytes, 0)))
+        { }
+    }
+
+    IrcIoThreadPool* pool;
+    IrcMpscQueue<IrcIoThreadPool::Request> requests;
+};
+
+
+IrcIoThreadPool::IrcIoThreadPool(int threadCount, QObject* parent)
+    : QObject(parent),
+      nextWorker(0)
+{
+    Q_ASSERT(threadCount > 0);
+    for (int i = 0; i < threadCount; ++i)
+    {
+        auto thread = new QThread(this);
+        thread->setObjectName(QStringLiteral("irc-io-%1").arg(i));
+
+        auto worker = new IrcIoWorker(this);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        threads.append(thread);
+        workers.append(worker);
+        thread->start();
+    }
+}
+
+
+IrcIoThreadPool::~IrcIoThreadPool()
+{
+    // workers delete themselves, and the sockets they own, as their threads finish
+    for (auto thread : threads)
+    {
+        thread->quit();
+    }
+    for (auto thread : threads)
+    {
+        thread->wait();
+    }
+}
+
+
+std::shared_ptr<IrcIoLink> IrcIoThreadPool::attach(QTcpSocket* socket)
+{
+    auto link = std::make_shared<IrcIoLink>();
+    link->worker = workers[nextWorker];
+    nextWorker = (nextWorker + 1) % workers.size();
+
+    // hand the socket over; from here on only the worker touches it
+    socket->setParent(nullptr);
+    socket->moveToThread(link->worker->thread());
+    link->socket = socket;
+
+    Request request;
+    request.type = Request::Type::Open;
+    post(link, std::move(request));
+    return link;
+}
+
+
+void IrcIoThreadPool::write(const std::shared_ptr<IrcIoLink>& link, const QByteArray& data)
+{
+    if (link->closed)
+    {
+        return;
+    }
+    link->pendingBytes += data.size();
+
+    Request request;
+    request.type = Request::Type::Write;
+    request.data = data;
+    post(link, std::move(request));
+}
+
+
+void IrcIoThreadPool::close(const std::shared_ptr<IrcIoLink>& link)
+{
+    Request request;
+    request.type = Request::Type::Close;
+    post(link, std::move(request));
+}
+
+
+void IrcIoThreadPool::abort(const std::shared_ptr<IrcIoLink>& link)
+{
+    Request request;
+    request.type = Request::Type::Abort;
+    post(link, std::move(request));
+}
+
+
+void IrcIoThreadPool::post(const std::shared_ptr<IrcIoLink>& link, Request request)
+{
+    request.link = link;
+    link->worker->post(std::move(request));
+}
+
+
+void IrcIoThreadPool::post(Event event)
+{
+    if (events.push(std::move(event)))
+    {
+        QMetaObject::invokeMethod(this, [this]() { processEvents(); }, Qt::QueuedConnection);
+    }
+}
+
+
+void IrcIoThreadPool::processEvents()
+{
+    events.beginDrain();
+
+    Event event;
+    while (events.pop(event))
+    {
+        // the connection may have been deleted since the event was queued
+        if (event.link->connection != nullptr)
+        {
+            event.link->connection->ioEvent(event);
+        }
+        event = {};
+    }
+}
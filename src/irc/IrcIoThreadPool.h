@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+#include "IrcLineReader.h"
+#include "IrcMessage.h"
+#include "IrcMpscQueue.h"
+
+class IrcConnection;
+class IrcIoWorker;
+class QTcpSocket;
+class QThread;
+
+/*
+ * One client socket handed to the pool. The socket, and reading and parsing
+ * its lines, belong to a worker thread; the IrcConnection it feeds stays on
+ * the server's thread. Each field is only touched from the thread noted.
+ */
+struct IrcIoLink
+{
+    // server thread
+    IrcConnection* connection = nullptr;
+
+    // set by attach(), never changes afterwards
+    IrcIoWorker* worker = nullptr;
+
+    // worker thread
+    QTcpSocket* socket = nullptr;
+    IrcLineReader reader;
+    IrcMessage message;
+    bool rejected = false;
+
+    // bytes handed to the worker for writing which the socket hasn't sent yet;
+    // added to by the server thread, drained by the worker
+    std::atomic<qint64> pendingBytes{0};
+    // set by the worker once the socket is gone; writes after that are dropped
+    std::atomic_bool closed{false};
+};
+
+/*
+ * Runs client socket I/O and line parsing on a fixed set of threads, each
+ * with its own event loop; connections are assigned round-robin. Parsed
+ * commands are handed to the server thread through a lock-free queue, so
+ * busy IRC clients don't hold up the thread libtego's callbacks run on.
+ *
+ * Lives on the server's thread; every public member is called from there.
+ */
+class IrcIoThreadPool : public QObject
+{
+    Q_OBJECT
+public:
+    IrcIoThreadPool(int threadCount, QObject* parent = nullptr);
+    ~IrcIoThreadPool();
+
+    /**
+     * @brief move socket over to the next worker thread. socket may not be
+     * used by the caller afterwards; set the returned link's connection to
+     * receive its commands.
+     */
+    std::shared_ptr<IrcIoLink> attach(QTcpSocket* socket);
+
+    // queue bytes to be written to the link's socket
+    void write(const std::shared_ptr<IrcIoLink>& link, const QByteArray& data);
+    // close the socket once everything queued before has been written
+    void close(const std::shared_ptr<IrcIoLink>& link);
+    // close the socket immediately, dropping anything not yet written
+    void abort(const std::shared_ptr<IrcIoLink>& link);
+
+    // an instruction for a worker thread
+    struct Request
+    {
+        enum class Type { Open, Write, Close, Abort };
+        Type type = Type::Write;
+        std::shared_ptr<IrcIoLink> link;
+        QByteArray data;
+    };
+
+    // something a worker thread needs the server thread to act on
+    struct Event
+    {
+        enum class Type { Command, LineTooLong, InvalidLine, Disconnected };
+        Type type = Type::Command;
+        std::shared_ptr<IrcIoLink> link;
+        // the message's tags, still escaped
+        QByteArray tags;
+        QByteArray command;
+        QList<QString> params;
+    };
+
+    // called by workers, from their threads
+    void post(Event event);
+
+private:
+    void post(const std::shared_ptr<IrcIoLink>& link, Request request);
+    void processEvents();
+
+    QVector<QThread*> threads;
+    QVector<IrcIoWorker*> workers;
+    int nextWorker;
+
+    IrcMpscQueue<Event> events;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <cstring>
+#include <string_view>
+
+#include "IrcMessage.h"
+
+/*
+ * Splits the bytes read from a client into IRC lines, keeping partial lines
+ * across reads. Used both by IrcConnection itself and, when the server runs
+ * its socket I/O on worker threads, by IrcIoThreadPool.
+ */
+class IrcLineReader
+{
+public:
+    // IRCv3 allows 8191 bytes of tags on top of RFC 1459's 512 byte lines
+    static constexpr int MaxLineLength = 8191 + 512;
+
+    /*
+     * Read everything available from device. Each complete, non-empty line
+     * is passed to onLine as a std::string_view without its CR LF; the view
+     * is only valid during the call. Lines longer than MaxLineLength are
+     * dropped and reported to onTooLong instead.
+     *
+     * onLine returns false to stop reading (e.g. the connection was closed);
+     * the reader must not be used again after that. Returns false if stopped.
+     */
+    template<typename OnLine, typename OnTooLong>
+    bool read(QIODevice* device, OnLine&& onLine, OnTooLong&& onTooLong)
+    {
+        qint64 available;
+        while ((available = device->bytesAvailable()) > 0)
+        {
+            // read straight onto the end of any partial line we already have
+            const int scanFrom = buffer.size();
+            buffer.resize(scanFrom + static_cast<int>(available));
+            const qint64 re = device->read(buffer.data() + scanFrom, available);
+            if (re <= 0)
+            {
+                buffer.resize(scanFrom);
+                return true;
+            }
+            buffer.resize(scanFrom + static_cast<int>(re));
+
+            // earlier bytes were already searched, so only look for line ends in the new ones
+            int lineBegin = 0;
+            const char* data = buffer.constData();
+            const char* nl;
+            int pos = scanFrom;
+            while ((nl = static_cast<const char*>(std::memchr(data + pos, '\n', static_cast<size_t>(buffer.size() - pos)))) != nullptr)
+            {
+                const int lineEnd = static_cast<int>(nl - data);
+                std::string_view line(data + lineBegin, static_cast<size_t>(lineEnd - lineBegin));
+                lineBegin = pos = lineEnd + 1;
+
+                if (discarding)
+                {
+                    // this ends the line we were dropping
+                    discarding = false;
+                    continue;
+                }
+                if (!line.empty() && line.back() == '\r')
+                {
+                    line.remove_suffix(1);
+                }
+                if (line.size() > static_cast<size_t>(MaxLineLength))
+                {
+                    onTooLong();
+                    continue;
+                }
+                if (!line.empty() && !onLine(line))
+                {
+                    return false;
+                }
+            }
+
+            // keep only the unterminated tail, unless it's already too long to ever be valid
+            if (discarding || buffer.size() - lineBegin > MaxLineLength)
+            {
+                if (!discarding)
+                {
+                    onTooLong();
+                    discarding = true;
+                }
+                buffer.clear();
+            }
+            else
+            {
+                buffer.remove(0, lineBegin);
+            }
+        }
+        return true;
+    }
+
+private:
+    // bytes received after the last complete line
+    QByteArray buffer;
+    // set while skipping the rest of a line that exceeded MaxLineLength
+    bool discarding = false;
+};
+
+// decode a parsed message's parameters from UTF-8
+inline QList<QString> ircMessageParams(const IrcMessage& message)
+{
+    QList<QString> params;
+    params.reserve(static_cast<int>(message.paramCount));
+    for (size_t i = 0; i < message.paramCount; ++i)
+    {
+        params.append(QString::fromUtf8(message.params[i].data(), static_cast<int>(message.params[i].size())));
+    }
+    return params;
+}
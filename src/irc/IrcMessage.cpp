@@ -0,0 +1,116 @@
+#include "IrcMessage.h"
+
+#include <algorithm>
+
+namespace
+{
+    // returns the offset of the first byte at or after pos which isn't a space
+    std::size_t skipSpaces(std::string_view line, std::size_t pos)
+    {
+        while (pos < line.size() && line[pos] == ' ')
+        {
+            ++pos;
+        }
+        return pos;
+    }
+
+    // returns the token starting at pos and ending before the next space (or end of line)
+    // and advances pos past it
+    std::string_view nextToken(std::string_view line, std::size_t& pos)
+    {
+        const auto end = std::min(line.find(' ', pos), line.size());
+        const auto token = line.substr(pos, end - pos);
+        pos = end;
+        return token;
+    }
+
+    bool isCommandChar(char c)
+    {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+    }
+}
+
+bool IrcMessage::findTag(std::string_view tags, std::string_view key, std::string_view* value)
+{
+    std::size_t pos = 0;
+    while (pos <= tags.size())
+    {
+        const auto end = std::min(tags.find(';', pos), tags.size());
+        const auto tag = tags.substr(pos, end - pos);
+        const auto eq = tag.find('=');
+        if (tag.substr(0, eq) == key)
+        {
+            *value = eq == std::string_view::npos ? std::string_view() : tag.substr(eq + 1);
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+bool IrcMessage::parse(std::string_view line)
+{
+    tags = {};
+    prefix = {};
+    command = {};
+    paramCount = 0;
+
+    // NUL, CR and LF may not appear anywhere within a message
+    constexpr std::string_view forbidden("\0\r\n", 3);
+    if (line.find_first_of(forbidden) != std::string_view::npos)
+    {
+        return false;
+    }
+
+    std::size_t pos = skipSpaces(line, 0);
+
+    if (pos < line.size() && line[pos] == '@')
+    {
+        ++pos;
+        tags = nextToken(line, pos);
+        pos = skipSpaces(line, pos);
+    }
+
+    if (pos < line.size() && line[pos] == ':')
+    {
+        ++pos;
+        prefix = nextToken(line, pos);
+        if (prefix.empty())
+        {
+            return false;
+        }
+        pos = skipSpaces(line, pos);
+    }
+
+    command = nextToken(line, pos);
+    if (command.empty())
+    {
+        return false;
+    }
+    for (char c : command)
+    {
+        if (!isCommandChar(c))
+        {
+            return false;
+        }
+    }
+
+    while ((pos = skipSpaces(line, pos)) < line.size())
+    {
+        // a ':' introduces the trailing parameter, which runs to the end of the line
+        // and may contain spaces; so does the last parameter we have room for
+        if (line[pos] == ':' || paramCount == MaxParams - 1)
+        {
+            if (line[pos] == ':')
+            {
+                ++pos;
+            }
+            params[paramCount++] = line.substr(pos);
+            break;
+        }
+
+        params[paramCount++] = nextToken(line, pos);
+    }
+
+    return true;
+}
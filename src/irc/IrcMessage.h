@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+/*
+ * A single IRC message as received from a client, per RFC 1459 with IRCv3
+ * message tags:
+ *
+ *   [@tags ] [:prefix ] command [params...] [:trailing]
+ *
+ * Every field is a view into the line that was parsed, so an IrcMessage is
+ * only valid as long as that line is. The trailing parameter (if any) is
+ * stored as the last entry of params.
+ */
+struct IrcMessage
+{
+    // RFC 1459 allows at most 15 parameters
+    static constexpr std::size_t MaxParams = 15;
+
+    std::string_view tags;
+    std::string_view prefix;
+    std::string_view command;
+    std::array<std::string_view, MaxParams> params;
+    std::size_t paramCount = 0;
+
+    /*
+     * Parse 'line' (without its terminating CRLF) into this message. Returns
+     * false if the line is not a valid IRC message: it is empty, has no
+     * command, or contains NUL, CR or LF bytes. Never allocates.
+     */
+    bool parse(std::string_view line);
+
+    /*
+     * Look up key in a tags string such as this->tags ("a=1;+b;c=x\\sy").
+     * The value is returned still escaped; a tag without a value has an
+     * empty one.
+     */
+    static bool findTag(std::string_view tags, std::string_view key, std::string_view* value);
+};
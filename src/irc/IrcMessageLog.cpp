@@ -0,0 +1,368 @@
+#include "IrcMessageLog.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QtEndian>
+#include <algorithm>
+
+IrcMessageLog::IrcMessageLog(const QString& directory, const QString& name, int maxEntries, qint64 segmentSize)
+    : directory(directory),
+      name(name),
+      maxEntries(maxEntries),
+      segmentSize(segmentSize),
+      nextId(1),
+      lastTime(0)
+{
+}
+
+
+IrcMessageLog::~IrcMessageLog() = default;
+
+
+bool IrcMessageLog::open()
+{
+    QDir dir(directory);
+    if (!dir.mkpath(QStringLiteral(".")))
+    {
+        qWarning() << "Cannot create message log directory" << directory;
+        return false;
+    }
+
+    // zero padded names sort by first id
+    const auto files = dir.entryInfoList({QStringLiteral("*.log")}, QDir::Files, QDir::Name);
+    for (const auto& fileInfo : files)
+    {
+        bool ok = false;
+        const quint64 firstId = fileInfo.completeBaseName().toULongLong(&ok);
+        if (!ok)
+        {
+            continue;
+        }
+        segments.append({firstId, fileInfo.filePath(), 0, 0});
+        if (!scanSegment(static_cast<int>(segments.size()) - 1))
+        {
+            segments.removeLast();
+        }
+    }
+
+    if (!index.isEmpty())
+    {
+        nextId = index.last().id + 1;
+        lastTime = index.last().time;
+    }
+    else if (!segments.isEmpty())
+    {
+        nextId = std::max(nextId, segments.last().firstId);
+    }
+
+    if (!segments.isEmpty())
+    {
+        activeFile = std::make_unique<QFile>(segments.last().path);
+        if (!activeFile->open(QIODevice::WriteOnly | QIODevice::Append))
+        {
+            qWarning() << "Cannot open message log segment" << segments.last().path << activeFile->errorString();
+            activeFile.reset();
+        }
+    }
+
+    compact();
+    return true;
+}
+
+
+bool IrcMessageLog::scanSegment(int segment)
+{
+    auto& seg = segments[segment];
+    QFile file(seg.path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Cannot read message log segment" << seg.path << file.errorString();
+        return false;
+    }
+
+    // only the headers are read; payloads are skipped
+    const qint64 fileSize = file.size();
+    qint64 offset = 0;
+    char header[RecordHeaderSize];
+    while (offset + RecordHeaderSize <= fileSize)
+    {
+        if (!file.seek(offset) || file.read(header, RecordHeaderSize) != RecordHeaderSize)
+        {
+            break;
+        }
+        const auto length = qFromLittleEndian<quint32>(header);
+        if (offset + RecordHeaderSize + length > fileSize)
+        {
+            break;
+        }
+        const auto id = qFromLittleEndian<quint64>(header + 4);
+        const auto time = qFromLittleEndian<qint64>(header + 12);
+
+        index.append({id, time, segment, offset});
+        ++seg.entries;
+        offset += RecordHeaderSize + length;
+    }
+    file.close();
+
+    // a record cut short by a crash is dropped so appends start cleanly
+    if (offset < fileSize)
+    {
+        qWarning() << "Truncating damaged message log segment" << seg.path << "to" << offset << "bytes";
+        QFile::resize(seg.path, offset);
+    }
+    seg.size = offset;
+    return true;
+}
+
+
+bool IrcMessageLog::startSegment(quint64 firstId)
+{
+    const QString path = QDir(directory).filePath(QStringLiteral("%1.log").arg(firstId, 20, 10, QLatin1Char('0')));
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        qWarning() << "Cannot create message log segment" << path << file->errorString();
+        return false;
+    }
+
+    segments.append({firstId, path, file->size(), 0});
+    activeFile = std::move(file);
+    return true;
+}
+
+
+quint64 IrcMessageLog::append(qint64 time, bool outgoing, const QString& text)
+{
+    if (!activeFile || (segments.last().size >= segmentSize && segments.last().entries > 0))
+    {
+        // an empty segment that couldn't be opened would be recreated under the same name
+        if (!segments.isEmpty() && segments.last().entries == 0)
+        {
+            segments.removeLast();
+        }
+        if (!startSegment(nextId))
+        {
+            return 0;
+        }
+    }
+
+    // keep times ordered, so they can be searched like ids
+    time = std::max(time, lastTime);
+
+    const QByteArray payload = text.toUtf8();
+    QByteArray record(static_cast<int>(RecordHeaderSize), Qt::Uninitialized);
+    qToLittleEndian<quint32>(static_cast<quint32>(payload.size()), record.data());
+    qToLittleEndian<quint64>(nextId, record.data() + 4);
+    qToLittleEndian<qint64>(time, record.data() + 12);
+    record[20] = static_cast<char>(outgoing ? FlagOutgoing : 0);
+    record.append(payload);
+
+    auto& seg = segments.last();
+    if (activeFile->write(record) != record.size() || !activeFile->flush())
+    {
+        qWarning() << "Cannot write message log segment" << seg.path << activeFile->errorString();
+        // don't leave half a record behind for the next append to follow
+        activeFile->resize(seg.size);
+        return 0;
+    }
+
+    index.append({nextId, time, static_cast<int>(segments.size()) - 1, seg.size});
+    seg.size += record.size();
+    ++seg.entries;
+    lastTime = time;
+
+    if (index.size() > maxEntries)
+    {
+        compact();
+    }
+    return nextId++;
+}
+
+
+void IrcMessageLog::compact()
+{
+    // only whole segments are dropped, and never the one being appended to
+    int dropped = 0;
+    int droppedEntries = 0;
+    while (dropped < segments.size() - 1 &&
+           index.size() - droppedEntries - segments[dropped].entries >= maxEntries)
+    {
+        if (!QFile::remove(segments[dropped].path))
+        {
+            qWarning() << "Cannot remove message log segment" << segments[dropped].path;
+            break;
+        }
+        droppedEntries += segments[dropped].entries;
+        ++dropped;
+    }
+
+    if (dropped == 0)
+    {
+        return;
+    }
+
+    segments.remove(0, dropped);
+    index.remove(0, droppedEntries);
+    for (auto& entry : index)
+    {
+        entry.segment -= dropped;
+    }
+}
+
+
+void IrcMessageLog::removeFiles()
+{
+    activeFile.reset();
+    for (const auto& seg : segments)
+    {
+        QFile::remove(seg.path);
+    }
+    QDir().rmdir(directory);
+
+    segments.clear();
+    index.clear();
+}
+
+
+int IrcMessageLog::size() const
+{
+    return static_cast<int>(index.size());
+}
+
+
+QString IrcMessageLog::msgid(quint64 id) const
+{
+    return QStringLiteral("%1-%2").arg(name).arg(id);
+}
+
+
+bool IrcMessageLog::parseMsgid(const QString& msgid, quint64* id) const
+{
+    if (msgid.size() <= name.size() + 1 || !msgid.startsWith(name) || msgid.at(name.size()) != QLatin1Char('-'))
+    {
+        return false;
+    }
+
+    bool ok = false;
+    *id = msgid.mid(name.size() + 1).toULongLong(&ok);
+    return ok;
+}
+
+
+int IrcMessageLog::lowerBound(const Ref& ref) const
+{
+    switch (ref.type)
+    {
+        case Ref::Type::MsgId:
+            return static_cast<int>(std::lower_bound(index.begin(), index.end(), ref.id,
+                [](const IndexEntry& entry, quint64 id) { return entry.id < id; }) - index.begin());
+        case Ref::Type::Timestamp:
+            return static_cast<int>(std::lower_bound(index.begin(), index.end(), ref.time,
+                [](const IndexEntry& entry, qint64 time) { return entry.time < time; }) - index.begin());
+        case Ref::Type::None:
+            break;
+    }
+    return size();
+}
+
+
+int IrcMessageLog::upperBound(const Ref& ref) const
+{
+    switch (ref.type)
+    {
+        case Ref::Type::MsgId:
+            return static_cast<int>(std::upper_bound(index.begin(), index.end(), ref.id,
+                [](quint64 id, const IndexEntry& entry) { return id < entry.id; }) - index.begin());
+        case Ref::Type::Timestamp:
+            return static_cast<int>(std::upper_bound(index.begin(), index.end(), ref.time,
+                [](qint64 time, const IndexEntry& entry) { return time < entry.time; }) - index.begin());
+        case Ref::Type::None:
+            break;
+    }
+    return 0;
+}
+
+
+QList<IrcMessageLog::Entry> IrcMessageLog::before(const Ref& ref, int limit) const
+{
+    const int end = lowerBound(ref);
+    return read(std::max(0, end - limit), end);
+}
+
+
+QList<IrcMessageLog::Entry> IrcMessageLog::after(const Ref& ref, int limit) const
+{
+    const int begin = upperBound(ref);
+    return read(begin, std::min(size(), begin + std::max(0, limit)));
+}
+
+
+QList<IrcMessageLog::Entry> IrcMessageLog::latest(const Ref& ref, int limit) const
+{
+    const int end = size();
+    return read(std::max(upperBound(ref), end - limit), end);
+}
+
+
+QList<IrcMessageLog::Entry> IrcMessageLog::between(const Ref& from, const Ref& to, int limit) const
+{
+    // counting forward from 'from' if it is the earlier one, backward from it otherwise
+    if (lowerBound(from) <= lowerBound(to))
+    {
+        const int begin = upperBound(from);
+        return read(begin, std::min(lowerBound(to), begin + std::max(0, limit)));
+    }
+    const int end = lowerBound(from);
+    return read(std::max(upperBound(to), end - limit), end);
+}
+
+
+QList<IrcMessageLog::Entry> IrcMessageLog::read(int begin, int end) const
+{
+    QList<Entry> entries;
+    if (begin >= end)
+    {
+        return entries;
+    }
+    entries.reserve(end - begin);
+
+    QFile file;
+    int openSegment = -1;
+    char header[RecordHeaderSize];
+    for (int i = begin; i < end; ++i)
+    {
+        const auto& indexEntry = index[i];
+        if (indexEntry.segment != openSegment)
+        {
+            file.close();
+            file.setFileName(segments[indexEntry.segment].path);
+            if (!file.open(QIODevice::ReadOnly))
+            {
+                qWarning() << "Cannot read message log segment" << file.fileName() << file.errorString();
+                break;
+            }
+            openSegment = indexEntry.segment;
+        }
+
+        // records within a segment are contiguous, so this rarely seeks
+        if ((file.pos() != indexEntry.offset && !file.seek(indexEntry.offset)) ||
+            file.read(header, RecordHeaderSize) != RecordHeaderSize)
+        {
+            break;
+        }
+        const auto length = static_cast<qint64>(qFromLittleEndian<quint32>(header));
+        const QByteArray payload = file.read(length);
+        if (payload.size() != length)
+        {
+            break;
+        }
+
+        Entry entry;
+        entry.id = indexEntry.id;
+        entry.time = indexEntry.time;
+        entry.outgoing = (static_cast<quint8>(header[20]) & FlagOutgoing) != 0;
+        entry.text = QString::fromUtf8(payload);
+        entries.append(std::move(entry));
+    }
+    return entries;
+}
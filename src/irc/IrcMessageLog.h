@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+/*
+ * Append-only on-disk log of the messages exchanged with one contact, used
+ * to answer IRCv3 CHATHISTORY requests.
+ *
+ * Messages are written to segment files in the log's directory, each named
+ * after the id of its first message. Every record is a fixed size header
+ * (payload length, id, time, flags) followed by the UTF-8 text, so opening a
+ * log only reads the headers to rebuild its index. Ids and times only ever
+ * increase, so the index is searched by either with a binary search.
+ *
+ * Once a log holds more than maxEntries messages whole segments are dropped
+ * from the front, oldest first.
+ */
+class IrcMessageLog
+{
+public:
+    struct Entry
+    {
+        quint64 id = 0;
+        // milliseconds since the epoch, UTC
+        qint64 time = 0;
+        // sent by us rather than the contact
+        bool outgoing = false;
+        QString text;
+    };
+
+    // a point in the log that a CHATHISTORY request is relative to
+    struct Ref
+    {
+        enum class Type { None, MsgId, Timestamp };
+        Type type = Type::None;
+        quint64 id = 0;
+        qint64 time = 0;
+    };
+
+    static constexpr qint64 DefaultSegmentSize = 1024 * 1024;
+    static constexpr int DefaultMaxEntries = 10000;
+
+    /**
+     * @param directory where the segments live, created if needed
+     * @param name prefix of this log's msgids; should be unique per server
+     */
+    IrcMessageLog(const QString& directory, const QString& name,
+                  int maxEntries = DefaultMaxEntries, qint64 segmentSize = DefaultSegmentSize);
+    ~IrcMessageLog();
+
+    IrcMessageLog(const IrcMessageLog&) = delete;
+    IrcMessageLog& operator=(const IrcMessageLog&) = delete;
+
+    // read the existing segments; returns false if the directory is unusable
+    bool open();
+
+    // returns the new message's id, or 0 if it could not be written
+    quint64 append(qint64 time, bool outgoing, const QString& text);
+
+    // delete every segment, e.g. because the contact was removed
+    void removeFiles();
+
+    int size() const;
+
+    // msgid tag value for one of this log's ids, and back
+    QString msgid(quint64 id) const;
+    bool parseMsgid(const QString& msgid, quint64* id) const;
+
+    /*
+     * The CHATHISTORY selectors. Each returns at most limit entries, oldest
+     * first; references are exclusive. A Ref of type None means "the start"
+     * for after() and "the end" for before() and latest().
+     */
+    QList<Entry> before(const Ref& ref, int limit) const;
+    QList<Entry> after(const Ref& ref, int limit) const;
+    QList<Entry> latest(const Ref& ref, int limit) const;
+    QList<Entry> between(const Ref& from, const Ref& to, int limit) const;
+
+private:
+    struct IndexEntry
+    {
+        quint64 id;
+        qint64 time;
+        int segment;
+        qint64 offset;
+    };
+
+    struct Segment
+    {
+        quint64 firstId;
+        QString path;
+        qint64 size;
+        int entries;
+    };
+
+    // header: quint32 payload length, quint64 id, qint64 time, quint8 flags
+    static constexpr qint64 RecordHeaderSize = 4 + 8 + 8 + 1;
+    static constexpr quint8 FlagOutgoing = 0x01;
+
+    // first index entry not before ref, i.e. the end of everything before it
+    int lowerBound(const Ref& ref) const;
+    // first index entry after ref
+    int upperBound(const Ref& ref) const;
+    QList<Entry> read(int begin, int end) const;
+
+    bool scanSegment(int segment);
+    bool startSegment(quint64 firstId);
+    void compact();
+
+    QString directory;
+    QString name;
+    int maxEntries;
+    qint64 segmentSize;
+
+    QVector<Segment> segments;
+    QVector<IndexEntry> index;
+    quint64 nextId;
+    qint64 lastTime;
+    // the newest segment, open for appending
+    std::unique_ptr<QFile> activeFile;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/*
+ * Unbounded lock-free multi-producer single-consumer queue (Vyukov's
+ * node based MPSC queue). Any thread may push(); only one thread at a time
+ * may pop().
+ *
+ * The queue can't cheaply tell a consumer that items are waiting, so it
+ * also carries a 'signalled' flag: producers call push() and, if it returns
+ * true, wake the consumer (e.g. by posting it an event). The consumer calls
+ * beginDrain() before popping; anything pushed after that wakes it again.
+ */
+template<typename T>
+class IrcMpscQueue
+{
+public:
+    IrcMpscQueue()
+    : head(new Node())
+    , tail(head.load(std::memory_order_relaxed))
+    { }
+
+    ~IrcMpscQueue()
+    {
+        T discarded;
+        while (pop(discarded)) { }
+        delete tail;
+    }
+
+    IrcMpscQueue(const IrcMpscQueue&) = delete;
+    IrcMpscQueue& operator=(const IrcMpscQueue&) = delete;
+
+    // returns true if the consumer needs to be woken up to see this item
+    bool push(T value)
+    {
+        auto node = new Node();
+        node->value = std::move(value);
+        auto prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+
+        return !signalled.exchange(true, std::memory_order_acq_rel);
+    }
+
+    // consumer only; must be called before draining the queue with pop()
+    void beginDrain()
+    {
+        signalled.exchange(false, std::memory_order_acq_rel);
+    }
+
+    // consumer only; returns false if nothing (more) is queued
+    bool pop(T& value)
+    {
+        auto next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+        {
+            return false;
+        }
+
+        // next becomes the new stub node, so its value is moved out
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    // producers append here
+    std::atomic<Node*> head;
+    // consumer side stub node, its value is always already consumed
+    Node* tail;
+    std::atomic<bool> signalled{false};
+};
@@ -33,6 +33,9 @@
 #include "IrcUser.h"
 #include "IrcChannel.h"
 #include "IrcConnection.h"
+#include "IrcCasemap.h"
+#include "IrcIoThreadPool.h"
+#include "IrcMessageLog.h"
 #include <QTcpSocket>
 #include <QTimer>
 #include <QException>
@@ -45,15 +48,23 @@ IrcServer::IrcServer(QObject *parent,
     : QObject(parent),
     m_host(host),
     m_port(port),
-    m_password(password)
+    m_password(password),
+    m_sendq_limit(DefaultSendQueueLimit),
+    m_io_threads(0),
+    tcpServer(Q_NULLPTR),
+    io_pool(Q_NULLPTR),
+    batch_seq(0)
 {
 }
 
 
 IrcServer::~IrcServer()
 {
-    tcpServer->close();
-    delete tcpServer;
+    if(tcpServer != Q_NULLPTR)
+    {
+        tcpServer->close();
+        delete tcpServer;
+    }
     foreach(IrcConnection* client, clients.values())
     {
         delete client;
@@ -62,11 +73,17 @@ IrcServer::~IrcServer()
     {
         delete channel;
     }
+    // stops the I/O threads; connections must be gone by now
+    delete io_pool;
 }
 
 
 bool IrcServer::run()
 {
+    if(m_io_threads > 0)
+    {
+        io_pool = new IrcIoThreadPool(m_io_threads, this);
+    }
     tcpServer = new QTcpServer(this);
     if(tcpServer->listen(m_host, m_port))
     {
@@ -91,7 +108,7 @@ void IrcServer::newConnection()
     {
         QTcpSocket *socket = tcpServer->nextPendingConnection();
         IrcConnection *conn = new IrcConnection(this, this, socket, m_password);
-        clients.insert(socket, conn);
+        clients.insert(conn);
         QObject::connect(conn,
                          SIGNAL(loggedIn()),
                          this,
@@ -151,6 +168,26 @@ const QString& IrcServer::password() const {
     return m_password;
 }
 
+qint64 IrcServer::sendQueueLimit() const {
+    return m_sendq_limit;
+}
+
+void IrcServer::setSendQueueLimit(qint64 bytes) {
+    m_sendq_limit = bytes;
+}
+
+int IrcServer::ioThreadCount() const {
+    return m_io_threads;
+}
+
+void IrcServer::setIoThreadCount(int count) {
+    m_io_threads = qMax(0, count);
+}
+
+IrcIoThreadPool* IrcServer::ioThreadPool() const {
+    return io_pool;
+}
+
 
 
 IrcChannel* IrcServer::getChannel(QString channel_name)
@@ -173,13 +210,16 @@ IrcChannel* IrcServer::getChannel(QString channel_name)
 }
 
 
-void IrcServer::channelMessage(IrcChannel* channel, QString msg, IrcUser* sender, bool include_sender)
+void IrcServer::channelMessage(IrcChannel* channel, const QString& msg, IrcUser* sender, bool include_sender)
 {
     if(channel == Q_NULLPTR)
     {
         qWarning() << "channelMessage called with NULL";
         return;
     }
+    // every member gets the same bytes, so only encode them once
+    const QByteArray line = IrcConnection::encodeLine(sender->getPrefix(), msg);
+    const QString time = IrcConnection::serverTime(QDateTime::currentMSecsSinceEpoch());
     foreach(IrcUser* member, channel->getMembers())
     {
         IrcConnection* conn = qobject_cast<IrcConnection*>(member);
@@ -187,22 +227,23 @@ void IrcServer::channelMessage(IrcChannel* channel, QString msg, IrcUser* sender
         {
             if(include_sender || member->nick != sender->nick)
             {
-                conn->reply(sender->getPrefix(), msg);
+                conn->sendTagged(line, QString(), time);
             }
         }
     }
 }
 
 
-void IrcServer::broadcast(IrcUser *sender, QString msg)
+void IrcServer::broadcast(IrcUser *sender, const QString& msg)
 {
+    const QByteArray line = IrcConnection::encodeLine(sender->getPrefix(), msg);
     foreach(IrcConnection* client, clients.values())
     {
         if(client != Q_NULLPTR)
         {
             if(client->isLoggedIn())
             {
-                client->reply(sender->getPrefix(), msg);
+                client->send(line);
             }
         }
         else
@@ -215,6 +256,10 @@ void IrcServer::broadcast(IrcUser *sender, QString msg)
 
 void IrcServer::privmsg(IrcUser* user, const QString& msgtarget, const QString& text)
 {
+    IrcConnection* sender = qobject_cast<IrcConnection*>(user);
+
+    // delivered to a channel or to any user we know, local or virtual
+    bool delivered = false;
     if(msgtarget[0] == QLatin1Char('#'))
     {
         QString channel_name = msgtarget;
@@ -222,19 +267,39 @@ void IrcServer::privmsg(IrcUser* user, const QString& msgtarget, const QString&
                        QStringLiteral("PRIVMSG %1 :%2").arg(channel_name).arg(text),
                        user,
                        false);
+        delivered = true;
     }
     else
     {
-        foreach(IrcConnection* conn, clients.values())
+        IrcUser* target = findUser(msgtarget);
+        IrcConnection* conn = qobject_cast<IrcConnection*>(target);
+        if(conn != Q_NULLPTR)
         {
-            if(conn->nick == msgtarget)
-            {
-                conn->reply(user->getPrefix(),
-                            QStringLiteral("PRIVMSG %1 :%2").arg(msgtarget).arg(text));
-            }
+            conn->sendTagged(IrcConnection::encodeLine(user->getPrefix(), QStringLiteral("PRIVMSG %1 :%2").arg(conn->nick).arg(text)),
+                             QString(),
+                             IrcConnection::serverTime(QDateTime::currentMSecsSinceEpoch()));
+        }
+        delivered = target != Q_NULLPTR;
+    }
+
+    // echo before the hook runs, so a bot's answer follows the command
+    if(sender != Q_NULLPTR && delivered)
+    {
+        sender->echoMessage(msgtarget, text);
+    }
+
+    const bool hooked = privmsgHook(user, msgtarget, text);
+    if(sender != Q_NULLPTR && !delivered)
+    {
+        if(hooked)
+        {
+            sender->echoMessage(msgtarget, text);
+        }
+        else
+        {
+            sender->reply(ERR_NOSUCHNICK, QStringLiteral("%1 %2 :No such nick/channel").arg(sender->nick).arg(msgtarget));
         }
     }
-    privmsgHook(user, msgtarget, text);
 }
 
 
@@ -275,6 +340,7 @@ void IrcServer::quit(IrcUser* conn)
     {
         chan->removeMember(conn);
     }
+    removeNick(conn);
 }
 
 
@@ -285,29 +351,154 @@ void IrcServer::disconnect(IrcConnection* conn)
     {
         chan->removeMember(conn);
     }
-    clients.remove(conn->getSocket());
+    clients.remove(conn);
+    removeNick(conn);
     ircUserLeft(conn);
-    conn->getSocket()->close();
+    conn->closeLink();
 }
 
 
-IrcUser* IrcServer::findUser(const QString& nickname)
+void IrcServer::chatHistory(IrcConnection* conn, const QList<QString>& params)
 {
-    foreach(IrcConnection* c, clients.values())
+    auto fail = [conn](const QString& code, const QString& context, const QString& description)
     {
-        if(c->nick == nickname)
-        {
-            return dynamic_cast<IrcUser*>(c);
-        }
+        conn->reply(QStringLiteral("FAIL CHATHISTORY %1 %2 :%3").arg(code).arg(context).arg(description));
+    };
+
+    if(params.size() < 1)
+    {
+        conn->reply(QStringLiteral("FAIL CHATHISTORY NEED_MORE_PARAMS :Missing subcommand"));
+        return;
+    }
+    const QString subcommand = params[0].toUpper();
+    const bool between = subcommand == QLatin1String("BETWEEN");
+    if(!between &&
+       subcommand != QLatin1String("BEFORE") &&
+       subcommand != QLatin1String("AFTER") &&
+       subcommand != QLatin1String("LATEST"))
+    {
+        fail(QStringLiteral("INVALID_PARAMS"), subcommand, QStringLiteral("Unknown subcommand"));
+        return;
+    }
+    if(params.size() < (between ? 5 : 4))
+    {
+        fail(QStringLiteral("NEED_MORE_PARAMS"), subcommand, QStringLiteral("Missing parameters"));
+        return;
+    }
+
+    const QString& target = params[1];
+    IrcUser* peer = findUser(target);
+    IrcMessageLog* log = peer != Q_NULLPTR ? messageLog(conn, target) : Q_NULLPTR;
+    if(log == Q_NULLPTR)
+    {
+        fail(QStringLiteral("INVALID_TARGET"), QStringLiteral("%1 %2").arg(subcommand).arg(target),
+             QStringLiteral("Messages could not be retrieved"));
+        return;
+    }
+
+    bool ok = false;
+    int limit = params.last().toInt(&ok);
+    if(!ok || limit < 0)
+    {
+        fail(QStringLiteral("INVALID_PARAMS"), subcommand, QStringLiteral("Invalid limit"));
+        return;
     }
-    foreach(IrcUser* u, virtual_clients)
+    limit = qMin(limit, ChatHistoryLimit);
+
+    // timestamp=YYYY-MM-DDThh:mm:ss.sssZ, msgid=... or, for LATEST only, *
+    auto parseRef = [&](const QString& text, IrcMessageLog::Ref& ref) -> bool
     {
-        if(u->nick == nickname)
+        if(text == QLatin1String("*"))
+        {
+            ref.type = IrcMessageLog::Ref::Type::None;
+            return subcommand == QLatin1String("LATEST");
+        }
+        if(text.startsWith(QLatin1String("timestamp=")))
         {
-            return u;
+            const QDateTime time = QDateTime::fromString(text.mid(10), Qt::ISODateWithMs);
+            ref.type = IrcMessageLog::Ref::Type::Timestamp;
+            ref.time = time.toMSecsSinceEpoch();
+            return time.isValid();
         }
+        if(text.startsWith(QLatin1String("msgid=")))
+        {
+            ref.type = IrcMessageLog::Ref::Type::MsgId;
+            return log->parseMsgid(text.mid(6), &ref.id);
+        }
+        return false;
+    };
+
+    IrcMessageLog::Ref from, to;
+    if(!parseRef(params[2], from) || (between && !parseRef(params[3], to)))
+    {
+        fail(QStringLiteral("INVALID_PARAMS"), subcommand, QStringLiteral("Invalid message reference"));
+        return;
+    }
+
+    QList<IrcMessageLog::Entry> entries;
+    if(subcommand == QLatin1String("BEFORE"))
+    {
+        entries = log->before(from, limit);
+    }
+    else if(subcommand == QLatin1String("AFTER"))
+    {
+        entries = log->after(from, limit);
+    }
+    else if(subcommand == QLatin1String("LATEST"))
+    {
+        entries = log->latest(from, limit);
+    }
+    else
+    {
+        entries = log->between(from, to, limit);
+    }
+
+    // with batch enabled the reply is always a batch, even an empty one
+    const QString batch = conn->beginBatch(QStringLiteral("chathistory"), target);
+    for(const IrcMessageLog::Entry& entry : entries)
+    {
+        const QByteArray line = entry.outgoing
+            ? IrcConnection::encodeLine(conn->getPrefix(), QStringLiteral("PRIVMSG %1 :%2").arg(peer->nick).arg(entry.text))
+            : IrcConnection::encodeLine(peer->getPrefix(), QStringLiteral("PRIVMSG %1 :%2").arg(conn->nick).arg(entry.text));
+        conn->sendTagged(line, batch, IrcConnection::serverTime(entry.time), log->msgid(entry.id));
+    }
+    conn->endBatch(batch);
+}
+
+
+QString IrcServer::nextBatchRef()
+{
+    return QString::number(++batch_seq, 36);
+}
+
+
+IrcUser* IrcServer::findUser(const QString& nickname)
+{
+    return nicks.value(ircCaseFold(nickname), Q_NULLPTR);
+}
+
+
+void IrcServer::addVirtualUser(IrcUser* user)
+{
+    virtual_clients.append(user);
+    nicks.insert(ircCaseFold(user->nick), user);
+}
+
+
+void IrcServer::removeVirtualUser(IrcUser* user)
+{
+    virtual_clients.removeOne(user);
+    removeNick(user);
+}
+
+
+void IrcServer::removeNick(IrcUser* user)
+{
+    auto it = nicks.find(ircCaseFold(user->nick));
+    if(it != nicks.end() && it.value() == user)
+    {
+        nicks.erase(it);
     }
-    return Q_NULLPTR;
 }
 
 
@@ -315,7 +506,9 @@ void IrcServer::rename(IrcUser *member, const QString& new_nick)
 {
     IrcConnection* conn = qobject_cast<IrcConnection*>(sender());
 
-    if(findUser(new_nick) != Q_NULLPTR)
+    // changing only the case of our own nick is fine
+    IrcUser* existing = findUser(new_nick);
+    if(existing != Q_NULLPTR && existing != member)
     {
         conn->reply(ERR_NICKNAMEINUSE,
                     QStringLiteral("%1 %2 :Nickname already in use.").arg(member->nick).arg(new_nick));
@@ -323,7 +516,15 @@ void IrcServer::rename(IrcUser *member, const QString& new_nick)
     }
 
     broadcast(member, QStringLiteral("NICK :%1").arg(new_nick));
+
+    const QString old_nick = member->nick;
+    removeNick(member);
     member->nick = new_nick;
+    nicks.insert(ircCaseFold(new_nick), member);
+    foreach(IrcChannel* chan, channels)
+    {
+        chan->memberRenamed(member, old_nick);
+    }
 }
 
 
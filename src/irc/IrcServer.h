@@ -37,9 +37,13 @@
 #include <QHostAddress>
 #include <QByteArray>
 #include <QHash>
+#include <QSet>
+#include <QStringList>
 
 class IrcChannel;
 class IrcConnection;
+class IrcIoThreadPool;
+class IrcMessageLog;
 class IrcUser;
 
 class IrcServer : public QObject
@@ -54,8 +58,19 @@ public:
 
     IrcChannel* getChannel(QString channel_name);
 
+    /**
+     * @brief look up a connected or virtual user by nick, ignoring case
+     * (RFC 1459 casemapping)
+     */
     IrcUser* findUser(const QString& nickname);
 
+    /**
+     * @brief add a user that exists only on the server side, e.g. a Ricochet
+     * contact; its nick must already be set
+     */
+    void addVirtualUser(IrcUser* user);
+    void removeVirtualUser(IrcUser* user);
+
     /**
      * @brief send a raw IRC message to everyone in a channel
      * @param channel IRC channel boject
@@ -63,14 +78,14 @@ public:
      * @param sender IRC user
      * @param include_sender also send to the sender themselves?
      */
-    void channelMessage(IrcChannel* channel, QString msg, IrcUser* sender, bool include_sender);
+    void channelMessage(IrcChannel* channel, const QString& msg, IrcUser* sender, bool include_sender);
 
     /**
      * @brief broadcast send message to EVERYONE
      * @param msg
      * @param sender
      */
-    void broadcast(IrcUser* sender, QString msg);
+    void broadcast(IrcUser* sender, const QString& msg);
 
     virtual const QString getWelcomeMessage();
 
@@ -78,6 +93,46 @@ public:
     uint16_t port();
     const QString& password() const;
 
+    // default for sendQueueLimit()
+    static constexpr qint64 DefaultSendQueueLimit = 4 * 1024 * 1024;
+
+    /**
+     * @brief maximum number of bytes queued for a single client before it is
+     * disconnected for not reading its replies (SendQ exceeded)
+     */
+    qint64 sendQueueLimit() const;
+    void setSendQueueLimit(qint64 bytes);
+
+    /**
+     * @brief number of threads running client socket I/O and line parsing;
+     * 0 (the default) keeps it on the server's own thread. Takes effect when
+     * the server is run().
+     */
+    int ioThreadCount() const;
+    void setIoThreadCount(int count);
+
+    // null unless the server runs with I/O threads
+    IrcIoThreadPool* ioThreadPool() const;
+
+    // most messages returned for one CHATHISTORY request
+    static constexpr int ChatHistoryLimit = 100;
+
+    /**
+     * @brief answer an IRCv3 CHATHISTORY request from conn
+     * @param params the command's parameters, starting with the subcommand
+     */
+    void chatHistory(IrcConnection* conn, const QList<QString>& params);
+
+    // a new, unique reference for a BATCH
+    QString nextBatchRef();
+
+    /**
+     * @brief tokens advertised to clients in RPL_ISUPPORT after they log in
+     */
+    virtual QStringList isupportTokens() {
+        return QStringList();
+    }
+
 signals:
 
 public slots:
@@ -92,6 +147,7 @@ public slots:
 
     /**
      * @brief IrcServer::privmsg slot for incoming PRIVMSGs; relays them to all recipients
+     * and echoes them back to the sender, or tells it there was no such recipient
      * @param user sender
      * @param msgtarget
      * @param text
@@ -118,17 +174,26 @@ protected:
     uint16_t m_port;
     QString m_password;
     QString welcome_message;
+    qint64 m_sendq_limit;
+    int m_io_threads;
 
     QTcpServer *tcpServer;
-    QHash<QTcpSocket*, IrcConnection*> clients;
+    IrcIoThreadPool *io_pool;
+    QSet<IrcConnection*> clients;
     QList<IrcUser*> virtual_clients;
+    // {case folded nick: user, ...} for clients and virtual_clients which have a nick
+    QHash<QString, IrcUser*> nicks;
     QHash<QString, IrcChannel*> channels;
+    // names the BATCHes we send
+    quint64 batch_seq;
 
     /**
      * @brief privmsgHook called after a PRIVMSG was processed
      * Override this to implement a bot.
+     * @return true if the hook delivered the message to a recipient the
+     * server doesn't know about itself
      */
-    virtual void privmsgHook(IrcUser*, const QString&, const QString&) {}
+    virtual bool privmsgHook(IrcUser*, const QString&, const QString&) { return false; }
 
     /**
      * @brief ircUserLoggedIn A new user connected successfully.
@@ -145,6 +210,20 @@ protected:
         Q_UNUSED(conn);
     };
 
+    /**
+     * @brief messageLog the log of private messages between requester and
+     * the user called target, for CHATHISTORY; null if there is none
+     */
+    virtual IrcMessageLog* messageLog(IrcUser* requester, const QString& target) {
+        Q_UNUSED(requester);
+        Q_UNUSED(target);
+        return Q_NULLPTR;
+    }
+
+private:
+    // drop user from the nick index, if it is what its current nick maps to
+    void removeNick(IrcUser* user);
+
 };
 
 #endif // IRCSERVER_H
@@ -38,6 +38,7 @@
 #include "IrcUser.h"
 #include "IrcChannel.h"
 #include "IrcConnection.h"
+#include "IrcMessageLog.h"
 
 #include "shims/ContactIDValidator.h"
 #include "shims/IncomingContactRequest.h"
@@ -53,7 +54,8 @@ RicochetIrcServer::RicochetIrcServer(QObject *parent,
                                      const QString& password,
                                      const QString& control_channel_name)
     : IrcServer(parent, host, port, password),
-      control_channel_name(control_channel_name)
+      control_channel_name(control_channel_name),
+      history_limit(0)
 {
 
 }
@@ -62,6 +64,72 @@ RicochetIrcServer::RicochetIrcServer(QObject *parent,
 RicochetIrcServer::~RicochetIrcServer()
 {
     delete ricochet_user;
+    qDeleteAll(logs);
+}
+
+
+void RicochetIrcServer::setHistory(const QString& dir, int limit)
+{
+    history_dir = dir;
+    history_limit = limit;
+}
+
+
+QStringList RicochetIrcServer::isupportTokens()
+{
+    QStringList tokens = IrcServer::isupportTokens();
+    if(!history_dir.isEmpty() && history_limit > 0)
+    {
+        tokens << QStringLiteral("CHATHISTORY=%1").arg(ChatHistoryLimit)
+               << QStringLiteral("MSGREFTYPES=msgid,timestamp");
+    }
+    return tokens;
+}
+
+
+IrcMessageLog* RicochetIrcServer::messageLog(IrcUser* requester, const QString& target)
+{
+    Q_UNUSED(requester);
+    shims::ContactUser* contact = contactmap.value(findUser(target), nullptr);
+    return contact != nullptr ? contactLog(contact) : nullptr;
+}
+
+
+QString RicochetIrcServer::contactLogDir(shims::ContactUser* contact) const
+{
+    if(history_dir.isEmpty())
+    {
+        return QString();
+    }
+
+    // one directory per contact, named by its service id
+    const QString serviceId = contact->getContactID().section(QLatin1Char(':'), 1);
+    return QDir(history_dir).filePath(serviceId);
+}
+
+
+IrcMessageLog* RicochetIrcServer::contactLog(shims::ContactUser* contact)
+{
+    if(history_dir.isEmpty() || history_limit <= 0)
+    {
+        return nullptr;
+    }
+
+    auto it = logs.constFind(contact);
+    if(it != logs.constEnd())
+    {
+        return it.value();
+    }
+
+    const QString serviceId = contact->getContactID().section(QLatin1Char(':'), 1);
+    auto log = new IrcMessageLog(contactLogDir(contact), serviceId.left(16), history_limit);
+    if(!log->open())
+    {
+        delete log;
+        return nullptr;
+    }
+    logs.insert(contact, log);
+    return log;
 }
 
 
@@ -133,7 +201,7 @@ bool RicochetIrcServer::run()
     ricochet_user->user = QStringLiteral("ricochet");
     ricochet_user->hostname = QStringLiteral("::1");
     ricochet_user->realname = QStringLiteral("Ricochet Control User");
-    this->virtual_clients.append(ricochet_user);
+    addVirtualUser(ricochet_user);
     connect(ricochet_user,
             &IrcUser::privmsg,
             this,
@@ -319,7 +387,7 @@ void RicochetIrcServer::highlight()
  * @param msgtarget  can be a #channel or a nickname
  * @param text
  */
-void RicochetIrcServer::privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text)
+bool RicochetIrcServer::privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text)
 {
     IrcConnection* sender_conn = qobject_cast<IrcConnection*>(sender);
 
@@ -362,11 +430,10 @@ void RicochetIrcServer::privmsgHook(IrcUser* sender, const QString& msgtarget, c
         {
             error(QStringLiteral("Unknown command: %1").arg(cmd));
         }
+        return false;
     }
-    else
-    {
-        handlePM(sender_conn, msgtarget, text);
-    }
+
+    return handlePM(sender_conn, msgtarget, text);
 }
 
 
@@ -377,35 +444,46 @@ void RicochetIrcServer::privmsgHook(IrcUser* sender, const QString& msgtarget, c
  * @param text
  *
  * Notify the IRC user if the contact is offline.
+ * @return true if there is such a contact and the message was sent or queued
  */
-void RicochetIrcServer::handlePM(IrcConnection *sender, const QString &contact_nick, const QString &text)
+bool RicochetIrcServer::handlePM(IrcConnection *sender, const QString &contact_nick, const QString &text)
 {
-    auto userIdentity = shims::UserIdentity::userIdentity;
-    auto contactsManager = userIdentity->getContacts();
-    foreach(shims::ContactUser* contact, contactsManager->contacts())
+    // the target's IRC user leads straight to its contact, this also honours
+    // IRC's case insensitive nicks
+    shims::ContactUser* contact = contactmap.value(findUser(contact_nick), nullptr);
+    if(contact == nullptr)
+    {
+        auto userIdentity = shims::UserIdentity::userIdentity;
+        contact = userIdentity->getContacts()->getShimContactByNickname(contact_nick);
+    }
+
+    if(contact != nullptr)
     {
-        if(contact->getNickname() == contact_nick)
+        contact->conversation()->sendMessage(text);
+        if(IrcMessageLog* log = contactLog(contact))
         {
-            contact->conversation()->sendMessage(text);
+            log->append(QDateTime::currentMSecsSinceEpoch(), true, text);
+        }
 
-            IrcUser* contact_irc_user = usermap.value(contact);
-            (void)contact_irc_user;
-            if(contact->getStatus() != shims::ContactUser::Status::Online)
-            {
-                sender->reply(RPL_AWAY,
-                            QStringLiteral("%1 %2 :is offline")
-                            .arg(sender->nick)
-                            .arg(contact->getNickname())
-                            );
-                // TODO
-//                sender->reply(contact_irc_user->getPrefix(),
-//                            QStringLiteral("PRIVMSG %1 :\x02[Contact is offline. %2 queued message(s).]")
-//                            .arg(sender->getPrefix())
-//                            .arg(contact->conversation()->queuedCount()));
+        IrcUser* contact_irc_user = usermap.value(contact);
+        (void)contact_irc_user;
+        if(contact->getStatus() != shims::ContactUser::Status::Online)
+        {
+            sender->reply(RPL_AWAY,
+                        QStringLiteral("%1 %2 :is offline")
+                        .arg(sender->nick)
+                        .arg(contact->getNickname())
+                        );
+            // TODO
+//            sender->reply(contact_irc_user->getPrefix(),
+//                        QStringLiteral("PRIVMSG %1 :\x02[Contact is offline. %2 queued message(s).]")
+//                        .arg(sender->getPrefix())
+//                        .arg(contact->conversation()->queuedCount()));
 
-            }
         }
+        return true;
     }
+    return false;
 }
 
 
@@ -482,10 +560,22 @@ void RicochetIrcServer::cmdDelete(const QStringList& args)
         shims::ContactUser *contact = contactsManager->getShimContactByNickname(args[0]);
         if(contact)
         {
+            const QString log_dir = contactLogDir(contact);
             contact->deleteContact();
-            virtual_clients.removeOne(usermap[contact]);
             quit(usermap.value(contact));
+            removeVirtualUser(usermap.value(contact));
+            contactmap.remove(usermap.value(contact));
             usermap.remove(contact);
+            if(IrcMessageLog* log = logs.take(contact))
+            {
+                log->removeFiles();
+                delete log;
+            }
+            else if(!log_dir.isEmpty())
+            {
+                // never opened; no need to index the segments just to delete them
+                QDir(log_dir).removeRecursively();
+            }
         }
         else
         {
@@ -509,29 +599,31 @@ void RicochetIrcServer::cmdRename(const QStringList& args)
         QString old_nickname = args[0];
         QString new_nickname = args[1];
 
-        if(contactsManager->getShimContactByNickname(new_nickname)
-                || findUser(new_nickname) != Q_NULLPTR)
+        auto cu = contactsManager->getShimContactByNickname(old_nickname);
+        IrcUser* ircuser = cu ? usermap.value(cu) : Q_NULLPTR;
+
+        // nick lookups are case folded, so changing only the case of a
+        // nickname finds the contact being renamed; that is no collision
+        auto existing_contact = contactsManager->getShimContactByNickname(new_nickname);
+        auto existing_user = findUser(new_nickname);
+        if((existing_contact != Q_NULLPTR && existing_contact != cu)
+                || (existing_user != Q_NULLPTR && existing_user != ircuser))
         {
             error(QStringLiteral("Target nickname `%1` already exists.").arg(new_nickname));
         }
-        else
+        else if(cu)
         {
-            auto cu = contactsManager->getShimContactByNickname(old_nickname);
-            if(cu)
+            echo(QStringLiteral("renaming user `%1` to `%2`").arg(old_nickname).arg(new_nickname));
+            cu->setNickname(new_nickname);
+            if(ircuser != Q_NULLPTR)
             {
-                echo(QStringLiteral("renaming user `%1` to `%2`").arg(old_nickname).arg(new_nickname));
-                cu->setNickname(new_nickname);
-                IrcUser* ircuser = usermap.value(cu);
-                if(ircuser != Q_NULLPTR)
-                {
-                    this->rename(ircuser, new_nickname);
-                }
-            }
-            else
-            {
-                echo(QStringLiteral("Contact not found."));
+                this->rename(ircuser, new_nickname);
             }
         }
+        else
+        {
+            echo(QStringLiteral("Contact not found."));
+        }
     }
     else
     {
@@ -639,7 +731,8 @@ void RicochetIrcServer::onContactStatusChanged(shims::ContactUser* user, int sta
         ctrlchan->addMember(ircuser, QStringLiteral("+v"));
         joined(ircuser, control_channel_name);
         usermap.insert(user, ircuser);
-        virtual_clients.append(ircuser);
+        contactmap.insert(ircuser, user);
+        addVirtualUser(ircuser);
     }
 
     switch(status)
@@ -671,6 +764,18 @@ void RicochetIrcServer::onContactStatusChanged(shims::ContactUser* user, int sta
 void RicochetIrcServer::onUnreadCountChanged()
 {
     shims::ConversationModel* convo = qobject_cast<shims::ConversationModel*>(sender());
+    IrcUser *ircuser = usermap[convo->contact()];
+    IrcMessageLog *log = contactLog(convo->contact());
+
+    // a line to deliver; everything but the target nick is the same for every
+    // client, so the parts around it are encoded once
+    struct Delivery
+    {
+        QByteArray tail;
+        QString time;
+        QString msgid;
+    };
+    QList<Delivery> deliveries;
 
     while(convo->rowCount())
     {
@@ -685,23 +790,53 @@ void RicochetIrcServer::onUnreadCountChanged()
             text = "unsupported message type";
         }
         bool isOutgoing = convo->data(index, shims::ConversationModel::IsOutgoingRole).toBool();
+        QDateTime timestamp = convo->data(index, shims::ConversationModel::TimestampRole).toDateTime();
         convo->clear();
 
         if(!isOutgoing)
         {
+            const qint64 time = timestamp.isValid() ? timestamp.toMSecsSinceEpoch() : QDateTime::currentMSecsSinceEpoch();
+
             // IRC has no concept of multi-line messages. Split them.
-            QStringList lines = text.split(QLatin1Char('\n'));
-            foreach(QString line, lines)
+            const QStringList lines = text.split(QLatin1Char('\n'));
+            for(const QString& line : lines)
             {
-                IrcUser *ircuser = usermap[convo->contact()];
-                foreach(IrcConnection *conn, clients.values())
+                Delivery delivery;
+                delivery.tail = QByteArrayLiteral(" :") + line.toUtf8() + QByteArrayLiteral("\r\n");
+                delivery.time = IrcConnection::serverTime(time);
+                // logged one IRC line per entry, so each gets its own msgid
+                if(log != nullptr)
                 {
-                    conn->reply(ircuser->getPrefix(),
-                                QStringLiteral("PRIVMSG %1 :%2").arg(conn->nick).arg(line));
+                    if(quint64 id = log->append(time, false, line))
+                    {
+                        delivery.msgid = log->msgid(id);
+                    }
                 }
+                deliveries.append(delivery);
             }
         }
     }
+
+    if(deliveries.isEmpty())
+    {
+        return;
+    }
+
+    const QByteArray head = QByteArrayLiteral(":") + ircuser->getPrefix().toUtf8() + QByteArrayLiteral(" PRIVMSG ");
+    const auto targets = clients.values();
+    for(IrcConnection *conn : targets)
+    {
+        // multi-line messages and backlog bursts go out as one batch
+        const QString batch = deliveries.size() > 1
+            ? conn->beginBatch(QStringLiteral("ricochetrefresh.net/messages"), ircuser->nick)
+            : QString();
+        const QByteArray nick = conn->nick.toUtf8();
+        for(const Delivery& delivery : deliveries)
+        {
+            conn->sendTagged(head + nick + delivery.tail, batch, delivery.time, delivery.msgid);
+        }
+        conn->endBatch(batch);
+    }
 }
 
 
@@ -44,6 +44,7 @@
 #include "shims/ConversationModel.h"
 
 class IrcUser;
+class IrcMessageLog;
 
 
 class RicochetIrcServer : public IrcServer
@@ -57,6 +58,15 @@ public:
                                const QString& control_channel_name = QStringLiteral("#ricochet"));
     ~RicochetIrcServer() override;
 
+    /**
+     * @brief keep a log of each contact's messages under dir, for CHATHISTORY;
+     * history is off while this is unset or limit is 0
+     * @param limit messages kept per contact
+     */
+    void setHistory(const QString& dir, int limit);
+
+    QStringList isupportTokens() override;
+
 public slots:
     bool run();
 
@@ -64,6 +74,7 @@ protected:
     void ircUserLoggedIn(IrcConnection* conn) override;
     void ircUserLeft(IrcConnection* conn) override;
     const QString getWelcomeMessage() override;
+    IrcMessageLog* messageLog(IrcUser* requester, const QString& target) override;
 
 private slots:
     void torConfigurationFinished();
@@ -83,13 +94,23 @@ private:
     QString control_channel_name;
     IrcUser *ricochet_user;
     QHash<shims::ContactUser*, IrcUser*> usermap;
+    // reverse of usermap
+    QHash<IrcUser*, shims::ContactUser*> contactmap;
+
+    QString history_dir;
+    int history_limit;
+    // opened on first use
+    QHash<shims::ContactUser*, IrcMessageLog*> logs;
+    IrcMessageLog* contactLog(shims::ContactUser* contact);
+    // where contactLog() keeps a contact's history; empty without a history directory
+    QString contactLogDir(shims::ContactUser* contact) const;
 
     void initRicochet();
     void startRicochet();
     void stopRicochet();
 
-    void privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text) override;
-    void handlePM(IrcConnection* sender, const QString& contact_nick, const QString& text);
+    bool privmsgHook(IrcUser* sender, const QString& msgtarget, const QString& text) override;
+    bool handlePM(IrcConnection* sender, const QString& contact_nick, const QString& text);
 
     void echo(const QString& text);
     void error(const QString& text);
@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <QCoreApplication>
+#include <QFileInfo>
 
 RicochetIrcServerTask::RicochetIrcServerTask(QCoreApplication* app)
     : QObject(app), irc_server(nullptr)
@@ -29,6 +30,14 @@ RicochetIrcServerTask::RicochetIrcServerTask(QCoreApplication* app)
     assert(password.length());
 
     irc_server = new RicochetIrcServer(this, host, port, password);
+    irc_server->setSendQueueLimit(static_cast<qint64>(
+        settings.read("irc.sendQueueLimit", static_cast<double>(IrcServer::DefaultSendQueueLimit)).toDouble()));
+    // client socket I/O threads; 0 keeps it on the main thread alongside libtego
+    irc_server->setIoThreadCount(settings.read("irc.ioThreads", 0).toInt());
+    // messages kept per contact for CHATHISTORY; history is only written to disk if enabled
+    irc_server->setHistory(
+        QFileInfo(SettingsObject::defaultFile()->filePath()).dir().filePath(QStringLiteral("irc-history")),
+        settings.read("irc.historyLimit", 0).toInt());
 }
 
 void RicochetIrcServerTask::run()
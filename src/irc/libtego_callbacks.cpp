@@ -8,8 +8,6 @@
 
 namespace
 {
-    constexpr int consumeInterval = 10;
-
     // this holds a callback which can be called and then deletes the underlying data
     // replaces std::function beause std::function cannot be move constructed >:[
     class run_once_task
@@ -116,17 +114,25 @@ namespace
 
         // clear out our queue
         localTaskQueue.clear();
-
-		// schedule us to run again
-	    QTimer::singleShot(consumeInterval, &consume_tasks);
     }
 
     template<typename FUNC>
     void push_task(FUNC&& func)
     {
         // acquire lock on the queue and push our received functor
-        std::lock_guard<std::mutex> lock(taskQueueLock);
-        taskQueue.push_back(std::move(func));
+        bool wasEmpty = false;
+        {
+            std::lock_guard<std::mutex> lock(taskQueueLock);
+            wasEmpty = taskQueue.empty();
+            taskQueue.push_back(std::move(func));
+        }
+
+        // the first task of a burst schedules a consume on the main thread's event loop,
+        // later ones are picked up by that same consume
+        if (wasEmpty)
+        {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), &consume_tasks, Qt::QueuedConnection);
+        }
     }
 
     QString serviceIdToContactId(const QString& serviceId)
@@ -572,9 +578,6 @@ namespace
 
 void init_libtego_callbacks(tego_context_t* context)
 {
-    // start triggering our consume queue
-    QTimer::singleShot(consumeInterval, &consume_tasks);
-
     //
     // register each of our callbacks with libtego
     //
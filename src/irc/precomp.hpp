@@ -14,6 +14,7 @@
 #include <cassert>
 #include <type_traits>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <fstream>
 #include <iterator>
@@ -26,8 +27,10 @@
 
 // Qt
 #include <QAbstractListModel>
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -39,6 +42,7 @@
 #include <QRegularExpressionValidator> // QtGui
 #endif
 #include <QSaveFile>
+#include <QSet>
 #include <QStandardPaths>
 #include <QTimer>
 #ifdef Q_OS_MAC
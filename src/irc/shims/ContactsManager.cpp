@@ -42,6 +42,14 @@ namespace shims
         // creates a new contact from service id and nickname
         auto shimContact = new shims::ContactUser(serviceId, nickname);
         contactsList.push_back(shimContact);
+        contactsById.insert(shimContact->getContactID(), shimContact);
+        indexNickname(shimContact);
+
+        connect(shimContact, &shims::ContactUser::nicknameChanged, this, [self=this, shimContact]() -> void
+        {
+            self->unindexNickname(shimContact);
+            self->indexNickname(shimContact);
+        });
 
         // remove our reference and ready for deleting when contactDeleted signal is fireds
         connect(shimContact, &shims::ContactUser::contactDeleted, [self=this](shims::ContactUser* user) -> void
@@ -50,6 +58,8 @@ namespace shims
             auto it = std::find(self->contactsList.begin(), self->contactsList.end(), user);
             if (it != self->contactsList.end()) {
                 self->contactsList.erase(it);
+                self->contactsById.remove(user->getContactID());
+                self->unindexNickname(user);
                 user->deleteLater();
             }
 
@@ -61,27 +71,43 @@ namespace shims
 
     shims::ContactUser* ContactsManager::getShimContactByContactId(const QString& contactId) const
     {
-        logger::trace();
-        for(auto& cu : contactsList)
+        return contactsById.value(contactId, nullptr);
+    }
+
+    shims::ContactUser* ContactsManager::getShimContactByNickname(const QString& nickname) const {
+        return contactsByNickname.value(nickname, nullptr);
+    }
+
+    void ContactsManager::indexNickname(shims::ContactUser* user)
+    {
+        const auto nickname = user->getNickname();
+        indexedNicknames.insert(user, nickname);
+        // when nicknames collide the earliest added contact wins, as the old linear search did
+        if (!contactsByNickname.contains(nickname))
         {
-            logger::println("cu : {}", static_cast<void*>(cu));
-            if (cu->getContactID() == contactId)
-            {
-                logger::trace();
-                return cu;
-            }
+            contactsByNickname.insert(nickname, user);
         }
-        return nullptr;
     }
 
-    shims::ContactUser* ContactsManager::getShimContactByNickname(const QString& nickname) const {
-        for(auto cu : contactsList) {
-            if (cu->getNickname() == nickname)
+    void ContactsManager::unindexNickname(shims::ContactUser* user)
+    {
+        const auto nickname = indexedNicknames.take(user);
+        auto it = contactsByNickname.find(nickname);
+        if (it == contactsByNickname.end() || it.value() != user)
+        {
+            return;
+        }
+        contactsByNickname.erase(it);
+
+        // hand the nickname to any other contact sharing it; only happens on rename or delete
+        for (auto cu : contactsList)
+        {
+            if (cu != user && indexedNicknames.value(cu) == nickname)
             {
-                return cu;
+                contactsByNickname.insert(nickname, cu);
+                break;
             }
         }
-        return nullptr;
     }
 
     const QList<shims::ContactUser*>& ContactsManager::contacts() const
@@ -29,7 +29,15 @@ namespace shims
         void unreadCountChanged(shims::ContactUser *user, int unreadCount);
         void contactStatusChanged(shims::ContactUser* user, int status);
     private:
+        void indexNickname(shims::ContactUser* user);
+        void unindexNickname(shims::ContactUser* user);
+
         tego_context_t* context;
         mutable QList<shims::ContactUser*> contactsList;
+        // lookups by contact id ("ricochet:<service id>") and by nickname
+        QHash<QString, shims::ContactUser*> contactsById;
+        QHash<QString, shims::ContactUser*> contactsByNickname;
+        // the nickname each contact is indexed under, so renames can find the old entry
+        QHash<shims::ContactUser*, QString> indexedNicknames;
     };
 }
@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+
+#include "IrcServer.h"
+#include "IrcChannel.h"
+#include "IrcUser.h"
+#include "IrcCasemap.h"
+
+TEST_CASE(  "IRC nicks fold with RFC 1459 casemapping",
+            "[irc][nick]")
+{
+    REQUIRE(ircCaseFold(QStringLiteral("Nick[Away]\\~")) == QStringLiteral("nick{away}|^"));
+    REQUIRE(ircCaseFold(QStringLiteral("already{lower}|^")) == QStringLiteral("already{lower}|^"));
+}
+
+TEST_CASE(  "IrcServer and IrcChannel find users by nick regardless of case",
+            "[irc][nick]")
+{
+    IrcServer server;
+    IrcChannel channel(&server, QStringLiteral("#ricochet"));
+
+    auto user = new IrcUser(&server);
+    user->nick = QStringLiteral("Alice[m]");
+    server.addVirtualUser(user);
+    channel.addMember(user);
+
+    REQUIRE(server.findUser(QStringLiteral("alice{M}")) == user);
+    REQUIRE(channel.getMember(QStringLiteral("ALICE[M]")) == user);
+    REQUIRE(server.findUser(QStringLiteral("bob")) == nullptr);
+
+    channel.removeMember(user);
+    server.removeVirtualUser(user);
+    REQUIRE(server.findUser(QStringLiteral("Alice[m]")) == nullptr);
+    REQUIRE_FALSE(channel.hasMember(QStringLiteral("Alice[m]")));
+}
+
+TEST_CASE(  "Nick lookups with thousands of virtual users",
+            "[irc][nick][!benchmark]")
+{
+    // mirrors a large contact list, every contact is a virtual user in the control channel
+    constexpr int userCount = 5000;
+
+    IrcServer server;
+    IrcChannel channel(&server, QStringLiteral("#ricochet"));
+    QStringList nicks;
+    for(int i = 0; i < userCount; ++i)
+    {
+        auto user = new IrcUser(&server);
+        user->nick = QStringLiteral("Contact%1").arg(i);
+        server.addVirtualUser(user);
+        channel.addMember(user, QStringLiteral("+v"));
+        nicks.append(user->nick);
+    }
+
+    BENCHMARK("IrcServer::findUser over all users")
+    {
+        int found = 0;
+        for(const auto& nick : nicks)
+        {
+            found += server.findUser(nick) != nullptr;
+        }
+        return found;
+    };
+
+    BENCHMARK("IrcChannel::getMember over all members")
+    {
+        int found = 0;
+        for(const auto& nick : nicks)
+        {
+            found += channel.getMember(nick) != nullptr;
+        }
+        return found;
+    };
+}
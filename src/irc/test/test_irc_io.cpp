@@ -0,0 +1,119 @@
+#include <catch2/catch.hpp>
+
+#include <QBuffer>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IrcLineReader.h"
+#include "IrcMpscQueue.h"
+
+TEST_CASE(  "IrcMpscQueue keeps each producer's items in order",
+            "[irc][io]")
+{
+    constexpr int producerCount = 4;
+    constexpr int itemCount = 10000;
+
+    IrcMpscQueue<std::pair<int, int>> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producerCount; ++p)
+    {
+        producers.emplace_back([&queue, p]()
+        {
+            for (int i = 0; i < itemCount; ++i)
+            {
+                queue.push({p, i});
+            }
+        });
+    }
+
+    std::vector<int> next(producerCount, 0);
+    int received = 0;
+    while (received < producerCount * itemCount)
+    {
+        queue.beginDrain();
+        std::pair<int, int> item;
+        while (queue.pop(item))
+        {
+            REQUIRE(item.second == next[item.first]);
+            ++next[item.first];
+            ++received;
+        }
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    std::pair<int, int> item;
+    REQUIRE_FALSE(queue.pop(item));
+}
+
+TEST_CASE(  "IrcMpscQueue asks for a wakeup once per drain",
+            "[irc][io]")
+{
+    IrcMpscQueue<int> queue;
+    REQUIRE(queue.push(1));
+    REQUIRE_FALSE(queue.push(2));
+
+    queue.beginDrain();
+    int value;
+    REQUIRE(queue.pop(value));
+    REQUIRE(value == 1);
+    REQUIRE(queue.push(3));
+    REQUIRE(queue.pop(value));
+    REQUIRE(value == 2);
+    REQUIRE(queue.pop(value));
+    REQUIRE(value == 3);
+    REQUIRE_FALSE(queue.pop(value));
+}
+
+TEST_CASE(  "IrcLineReader splits lines and drops overlong ones",
+            "[irc][io]")
+{
+    QByteArray data;
+    QBuffer device(&data);
+    device.open(QIODevice::ReadWrite);
+
+    IrcLineReader reader;
+    std::vector<std::string> lines;
+    int tooLong = 0;
+    auto read = [&]()
+    {
+        return reader.read(&device,
+            [&](std::string_view line) { lines.emplace_back(line); return true; },
+            [&]() { ++tooLong; });
+    };
+    auto feed = [&](const QByteArray& bytes)
+    {
+        const auto pos = device.pos();
+        device.seek(data.size());
+        device.write(bytes);
+        device.seek(pos);
+    };
+
+    feed("NICK guest\r\nUSER gu");
+    REQUIRE(read());
+    REQUIRE(lines == std::vector<std::string>{"NICK guest"});
+
+    feed("est 0 * :Guest\n\r\nPING x\r\n");
+    REQUIRE(read());
+    REQUIRE(lines == std::vector<std::string>{"NICK guest", "USER guest 0 * :Guest", "PING x"});
+
+    // the overlong line is reported once, even though it arrives in pieces
+    feed(QByteArray(IrcLineReader::MaxLineLength + 1, 'a'));
+    REQUIRE(read());
+    feed("aaaa\r\nQUIT\r\n");
+    REQUIRE(read());
+    REQUIRE(tooLong == 1);
+    REQUIRE(lines.back() == "QUIT");
+    REQUIRE(lines.size() == 4);
+
+    // stopping leaves later lines unread
+    feed("PING 1\r\nPING 2\r\n");
+    REQUIRE_FALSE(reader.read(&device,
+        [&](std::string_view line) { lines.emplace_back(line); return false; },
+        [&]() { ++tooLong; }));
+    REQUIRE(lines.back() == "PING 1");
+}
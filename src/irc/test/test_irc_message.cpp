@@ -0,0 +1,125 @@
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+#include "IrcMessage.h"
+
+TEST_CASE(  "IrcMessage parses prefix, command and parameters",
+            "[irc][message][valid_input]")
+{
+    IrcMessage message;
+
+    REQUIRE(message.parse(":nick!user@host PRIVMSG #channel :hello there world"));
+    REQUIRE(message.tags.empty());
+    REQUIRE(message.prefix == "nick!user@host");
+    REQUIRE(message.command == "PRIVMSG");
+    REQUIRE(message.paramCount == 2);
+    REQUIRE(message.params[0] == "#channel");
+    REQUIRE(message.params[1] == "hello there world");
+
+    REQUIRE(message.parse("USER guest 0 * :Real Name"));
+    REQUIRE(message.prefix.empty());
+    REQUIRE(message.command == "USER");
+    REQUIRE(message.paramCount == 4);
+    REQUIRE(message.params[2] == "*");
+    REQUIRE(message.params[3] == "Real Name");
+
+    REQUIRE(message.parse("QUIT"));
+    REQUIRE(message.command == "QUIT");
+    REQUIRE(message.paramCount == 0);
+}
+
+TEST_CASE(  "IrcMessage parses IRCv3 tags",
+            "[irc][message][valid_input]")
+{
+    IrcMessage message;
+
+    REQUIRE(message.parse("@time=2021-01-01T00:00:00.000Z;label=abc :server 001 nick :Welcome"));
+    REQUIRE(message.tags == "time=2021-01-01T00:00:00.000Z;label=abc");
+    REQUIRE(message.prefix == "server");
+    REQUIRE(message.command == "001");
+    REQUIRE(message.paramCount == 2);
+    REQUIRE(message.params[1] == "Welcome");
+}
+
+TEST_CASE(  "IrcMessage keeps empty trailing parameters and collapses repeated spaces",
+            "[irc][message][valid_input]")
+{
+    IrcMessage message;
+
+    REQUIRE(message.parse("PRIVMSG #channel :"));
+    REQUIRE(message.paramCount == 2);
+    REQUIRE(message.params[1].empty());
+
+    REQUIRE(message.parse("JOIN   #a    #b  "));
+    REQUIRE(message.paramCount == 2);
+    REQUIRE(message.params[0] == "#a");
+    REQUIRE(message.params[1] == "#b");
+}
+
+TEST_CASE(  "IrcMessage treats the fifteenth parameter as trailing",
+            "[irc][message][valid_input]")
+{
+    IrcMessage message;
+
+    REQUIRE(message.parse("CMD 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16"));
+    REQUIRE(message.paramCount == IrcMessage::MaxParams);
+    REQUIRE(message.params[13] == "14");
+    REQUIRE(message.params[14] == "15 16");
+}
+
+TEST_CASE(  "IrcMessage rejects malformed lines",
+            "[irc][message][invalid_input]")
+{
+    IrcMessage message;
+
+    REQUIRE_FALSE(message.parse(""));
+    REQUIRE_FALSE(message.parse("   "));
+    REQUIRE_FALSE(message.parse(":prefixonly"));
+    REQUIRE_FALSE(message.parse(": PRIVMSG #channel :text"));
+    REQUIRE_FALSE(message.parse("PRIV-MSG #channel"));
+    REQUIRE_FALSE(message.parse("PRIVMSG #channel :line\r\nQUIT"));
+    REQUIRE_FALSE(message.parse(std::string_view("PRIVMSG #channel :a\0b", 21)));
+}
+
+TEST_CASE(  "IrcMessage parsing throughput",
+            "[irc][message][!benchmark]")
+{
+    // a pasted backlog, the case that motivated replacing the regular expression
+    std::vector<std::string> lines;
+    for (int i = 0; i < 1000; ++i)
+    {
+        lines.push_back("@time=2021-01-01T00:00:00.000Z :nick!user@host PRIVMSG #channel :backlog line " + std::to_string(i) + " with some typical chat text in it");
+    }
+
+    BENCHMARK("parse 1000 PRIVMSG lines")
+    {
+        IrcMessage message;
+        size_t params = 0;
+        for (const auto& line : lines)
+        {
+            message.parse(line);
+            params += message.paramCount;
+        }
+        return params;
+    };
+}
+
+TEST_CASE(  "IrcMessage finds tags by key",
+            "[irc][message][tags]")
+{
+    std::string_view value;
+
+    REQUIRE(IrcMessage::findTag("label=abc;+draft/typing=active;flag", "label", &value));
+    REQUIRE(value == "abc");
+    REQUIRE(IrcMessage::findTag("label=abc;+draft/typing=active;flag", "+draft/typing", &value));
+    REQUIRE(value == "active");
+    REQUIRE(IrcMessage::findTag("label=abc;+draft/typing=active;flag", "flag", &value));
+    REQUIRE(value.empty());
+    REQUIRE(IrcMessage::findTag("time=x\\sy", "time", &value));
+    REQUIRE(value == "x\\sy");
+
+    REQUIRE_FALSE(IrcMessage::findTag("label=abc", "lab", &value));
+    REQUIRE_FALSE(IrcMessage::findTag("", "label", &value));
+}
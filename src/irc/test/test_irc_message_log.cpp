@@ -0,0 +1,117 @@
+#include <catch2/catch.hpp>
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "IrcMessageLog.h"
+
+namespace
+{
+    IrcMessageLog::Ref msgidRef(quint64 id)
+    {
+        IrcMessageLog::Ref ref;
+        ref.type = IrcMessageLog::Ref::Type::MsgId;
+        ref.id = id;
+        return ref;
+    }
+
+    IrcMessageLog::Ref timeRef(qint64 time)
+    {
+        IrcMessageLog::Ref ref;
+        ref.type = IrcMessageLog::Ref::Type::Timestamp;
+        ref.time = time;
+        return ref;
+    }
+
+    QList<quint64> ids(const QList<IrcMessageLog::Entry>& entries)
+    {
+        QList<quint64> result;
+        for (const auto& entry : entries)
+        {
+            result.append(entry.id);
+        }
+        return result;
+    }
+}
+
+TEST_CASE(  "IrcMessageLog answers CHATHISTORY selectors oldest first",
+            "[irc][history]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    IrcMessageLog log(dir.path(), QStringLiteral("contact"));
+    REQUIRE(log.open());
+    // ids 1..10 at times 1000..10000
+    for (int i = 1; i <= 10; ++i)
+    {
+        REQUIRE(log.append(i * 1000, i % 2 == 0, QStringLiteral("message %1").arg(i)) == static_cast<quint64>(i));
+    }
+
+    const IrcMessageLog::Ref none;
+    REQUIRE(ids(log.latest(none, 3)) == QList<quint64>{8, 9, 10});
+    REQUIRE(ids(log.latest(msgidRef(8), 10)) == QList<quint64>{9, 10});
+    REQUIRE(ids(log.before(msgidRef(5), 2)) == QList<quint64>{3, 4});
+    REQUIRE(ids(log.after(timeRef(2000), 3)) == QList<quint64>{3, 4, 5});
+    REQUIRE(ids(log.after(timeRef(2500), 1)) == QList<quint64>{3});
+    REQUIRE(ids(log.between(msgidRef(2), msgidRef(6), 10)) == QList<quint64>{3, 4, 5});
+    REQUIRE(ids(log.between(msgidRef(2), msgidRef(6), 2)) == QList<quint64>{3, 4});
+    REQUIRE(ids(log.between(msgidRef(6), msgidRef(2), 2)) == QList<quint64>{4, 5});
+    REQUIRE(log.before(msgidRef(1), 5).isEmpty());
+
+    const auto entries = log.after(msgidRef(3), 2);
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].text == QStringLiteral("message 4"));
+    REQUIRE(entries[0].outgoing);
+    REQUIRE(entries[0].time == 4000);
+    REQUIRE(entries[1].text == QStringLiteral("message 5"));
+    REQUIRE_FALSE(entries[1].outgoing);
+
+    quint64 id = 0;
+    REQUIRE(log.parseMsgid(log.msgid(7), &id));
+    REQUIRE(id == 7);
+    REQUIRE_FALSE(log.parseMsgid(QStringLiteral("other-7"), &id));
+}
+
+TEST_CASE(  "IrcMessageLog survives reopening, torn writes and compaction",
+            "[irc][history]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    {
+        // tiny segments, so every few messages start a new one
+        IrcMessageLog log(dir.path(), QStringLiteral("contact"), 20, 64);
+        REQUIRE(log.open());
+        for (int i = 1; i <= 50; ++i)
+        {
+            REQUIRE(log.append(i, false, QStringLiteral("message %1").arg(i)) != 0);
+        }
+        REQUIRE(log.size() >= 20);
+        REQUIRE(log.size() < 50);
+    }
+
+    // simulate a crash part way through writing a record
+    const QStringList segments = QDir(dir.path()).entryList({QStringLiteral("*.log")}, QDir::Files, QDir::Name);
+    REQUIRE(segments.size() > 1);
+    {
+        QFile last(QDir(dir.path()).filePath(segments.last()));
+        REQUIRE(last.open(QIODevice::Append));
+        last.write("\x40\x00\x00\x00\x33", 5);
+    }
+
+    IrcMessageLog log(dir.path(), QStringLiteral("contact"), 20, 64);
+    REQUIRE(log.open());
+    const auto latest = log.latest(IrcMessageLog::Ref(), 1);
+    REQUIRE(latest.size() == 1);
+    REQUIRE(latest[0].id == 50);
+    REQUIRE(latest[0].text == QStringLiteral("message 50"));
+
+    // new messages continue the sequence, and times never go backwards
+    REQUIRE(log.append(0, true, QStringLiteral("later")) == 51);
+    REQUIRE(log.latest(IrcMessageLog::Ref(), 1)[0].time == 50);
+
+    log.removeFiles();
+    REQUIRE_FALSE(QDir(dir.path()).exists());
+}
@@ -0,0 +1,89 @@
+#include <catch2/catch.hpp>
+
+#include <QTemporaryDir>
+
+#include "utils/Settings.h"
+
+namespace
+{
+    QJsonObject readJson(const QString &path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return QJsonObject();
+        return QJsonDocument::fromJson(file.readAll()).object();
+    }
+}
+
+TEST_CASE(  "SettingsFile coalesces a burst of writes into one save",
+            "[irc][settings]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("ricochet.json"));
+
+    SettingsFile settings;
+    REQUIRE(settings.setFilePath(path));
+    REQUIRE_FALSE(settings.hasPendingChanges());
+
+    constexpr int contactCount = 10000;
+    SettingsObject contacts(&settings, QStringLiteral("contacts"));
+    for (int i = 0; i < contactCount; ++i)
+    {
+        contacts.write(QStringLiteral("contact%1.type").arg(i), QStringLiteral("allowed"));
+    }
+
+    // nothing is written until the event loop runs the sync timer
+    REQUIRE(settings.hasPendingChanges());
+    REQUIRE(readJson(path).isEmpty());
+
+    REQUIRE(settings.sync());
+    REQUIRE_FALSE(settings.hasPendingChanges());
+    REQUIRE(readJson(path).value(QStringLiteral("contacts")).toObject().size() == contactCount);
+}
+
+TEST_CASE(  "SettingsFile skips saves that change nothing",
+            "[irc][settings]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("ricochet.json"));
+
+    SettingsFile settings;
+    REQUIRE(settings.setFilePath(path));
+    settings.root()->write("identity.nickname", QStringLiteral("alice"));
+    REQUIRE(settings.sync());
+
+    // remove the file behind the SettingsFile's back: only a real save
+    // would bring it back
+    REQUIRE(QFile::remove(path));
+
+    settings.root()->write("identity.nickname", QStringLiteral("bob"));
+    settings.root()->write("identity.nickname", QStringLiteral("alice"));
+    REQUIRE(settings.hasPendingChanges());
+    REQUIRE(settings.sync());
+    REQUIRE_FALSE(QFile::exists(path));
+
+    settings.root()->write("identity.nickname", QStringLiteral("bob"));
+    REQUIRE(settings.sync());
+    REQUIRE(readJson(path).value(QStringLiteral("identity")).toObject().value(QStringLiteral("nickname")).toString() == QStringLiteral("bob"));
+}
+
+TEST_CASE(  "SettingsFile saves pending changes when destroyed",
+            "[irc][settings]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("ricochet.json"));
+
+    {
+        SettingsFile settings;
+        settings.setSyncDelay(60 * 1000);
+        settings.setMaxSyncDelay(60 * 1000);
+        REQUIRE(settings.setFilePath(path));
+        settings.root()->write("tor.socksPort", 9050);
+        REQUIRE(settings.hasPendingChanges());
+    }
+
+    REQUIRE(readJson(path).value(QStringLiteral("tor")).toObject().value(QStringLiteral("socksPort")).toInt() == 9050);
+}
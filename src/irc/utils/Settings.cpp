@@ -41,7 +41,17 @@ public:
     QString filePath;
     QString errorMessage;
     QTimer syncTimer;
+    int syncDelay;
+    int maxSyncDelay;
+    // started by the first change after a save
+    QElapsedTimer dirtySince;
     QJsonObject jsonRoot;
+    // jsonRoot as last read or saved
+    QJsonObject savedRoot;
+    // top level keys changed since the last save, and whether the root
+    // itself was replaced
+    QSet<QString> dirtyKeys;
+    bool rootDirty;
     SettingsObject *rootObject;
 
     SettingsFilePrivate(SettingsFile *qp);
@@ -53,6 +63,10 @@ public:
     bool readFile();
     bool writeFile();
 
+    bool hasPendingChanges() const;
+    void markDirty(const QStringList &path);
+    void scheduleSync();
+
     static QStringList splitPath(const QString &input, bool &ok);
     QJsonValue read(const QJsonObject &base, const QStringList &path);
     bool write(const QStringList &path, const QJsonValue &value);
@@ -60,8 +74,8 @@ public:
 signals:
     void modified(const QStringList &path, const QJsonValue &value);
 
-private slots:
-    void sync();
+public slots:
+    bool sync();
 };
 
 SettingsFile::SettingsFile(QObject *parent)
@@ -77,16 +91,18 @@ SettingsFile::~SettingsFile()
 SettingsFilePrivate::SettingsFilePrivate(SettingsFile *qp)
     : QObject(qp)
     , q(qp)
+    , syncDelay(250)
+    , maxSyncDelay(2000)
+    , rootDirty(false)
     , rootObject(0)
 {
-    syncTimer.setInterval(0);
     syncTimer.setSingleShot(true);
     connect(&syncTimer, &QTimer::timeout, this, &SettingsFilePrivate::sync);
 }
 
 SettingsFilePrivate::~SettingsFilePrivate()
 {
-    if (syncTimer.isActive())
+    if (hasPendingChanges())
         sync();
     delete rootObject;
 }
@@ -96,7 +112,13 @@ void SettingsFilePrivate::reset()
     filePath.clear();
     errorMessage.clear();
 
+    syncTimer.stop();
+    dirtySince.invalidate();
+    dirtyKeys.clear();
+    rootDirty = false;
+
     jsonRoot = QJsonObject();
+    savedRoot = jsonRoot;
     emit modified(QStringList(), jsonRoot);
 }
 
@@ -110,6 +132,8 @@ bool SettingsFile::setFilePath(const QString &filePath)
     if (d->filePath == filePath)
         return hasError();
 
+    if (d->hasPendingChanges())
+        d->sync();
     d->reset();
     d->filePath = filePath;
 
@@ -170,13 +194,90 @@ const SettingsObject *SettingsFile::root() const
     return d->rootObject;
 }
 
-void SettingsFilePrivate::sync()
+int SettingsFile::syncDelay() const
 {
-    if (filePath.isEmpty())
-        return;
+    return d->syncDelay;
+}
+
+void SettingsFile::setSyncDelay(int msec)
+{
+    d->syncDelay = qMax(0, msec);
+    if (d->syncTimer.isActive())
+        d->scheduleSync();
+}
+
+int SettingsFile::maxSyncDelay() const
+{
+    return d->maxSyncDelay;
+}
+
+void SettingsFile::setMaxSyncDelay(int msec)
+{
+    d->maxSyncDelay = qMax(0, msec);
+    if (d->syncTimer.isActive())
+        d->scheduleSync();
+}
+
+bool SettingsFile::hasPendingChanges() const
+{
+    return d->hasPendingChanges();
+}
+
+bool SettingsFile::sync()
+{
+    return d->sync();
+}
 
+bool SettingsFilePrivate::hasPendingChanges() const
+{
+    return rootDirty || !dirtyKeys.isEmpty();
+}
+
+void SettingsFilePrivate::markDirty(const QStringList &path)
+{
+    if (path.isEmpty())
+        rootDirty = true;
+    else
+        dirtyKeys.insert(path.first());
+}
+
+// Save syncDelay after the latest change, but no later than maxSyncDelay
+// after the first unsaved one
+void SettingsFilePrivate::scheduleSync()
+{
+    if (!dirtySince.isValid())
+        dirtySince.start();
+
+    qint64 remaining = qMax<qint64>(0, maxSyncDelay - dirtySince.elapsed());
+    syncTimer.start(int(qMin<qint64>(syncDelay, remaining)));
+}
+
+bool SettingsFilePrivate::sync()
+{
     syncTimer.stop();
-    writeFile();
+    if (filePath.isEmpty() || !hasPendingChanges())
+        return true;
+
+    // Changes that were undone before the save don't need one
+    bool changed = rootDirty;
+    for (QSet<QString>::const_iterator it = dirtyKeys.constBegin(); !changed && it != dirtyKeys.constEnd(); ++it)
+        changed = jsonRoot.value(*it) != savedRoot.value(*it);
+
+    dirtySince.invalidate();
+    dirtyKeys.clear();
+    rootDirty = false;
+
+    if (!changed)
+        return true;
+
+    if (!writeFile()) {
+        // Try again with the next change
+        rootDirty = true;
+        return false;
+    }
+
+    savedRoot = jsonRoot;
+    return true;
 }
 
 bool SettingsFilePrivate::readFile()
@@ -195,6 +296,7 @@ bool SettingsFilePrivate::readFile()
 
     if (data.isEmpty()) {
         jsonRoot = QJsonObject();
+        savedRoot = jsonRoot;
         return true;
     }
 
@@ -211,6 +313,7 @@ bool SettingsFilePrivate::readFile()
     }
 
     jsonRoot = document.object();
+    savedRoot = jsonRoot;
 
     emit modified(QStringList(), jsonRoot);
     return true;
@@ -340,7 +443,8 @@ bool SettingsFilePrivate::write(const QStringList &path, const QJsonValue &value
 
     // current is now the updated jsonRoot
     jsonRoot = current.toObject();
-    syncTimer.start();
+    markDirty(path);
+    scheduleSync();
 
     ModifiedList modified;
     findModifiedRecursive(modified, path, originalValue, value);
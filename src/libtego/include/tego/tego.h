@@ -427,6 +427,63 @@ void tego_context_get_users(
     size_t* out_userCount,
     tego_error_t** error);
 
+// fixed size description of a user, filled in place by
+// tego_context_get_user_records
+typedef struct tego_user_record
+{
+    // the user's v3 onion service id, null terminated
+    char serviceId[TEGO_V3_ONION_SERVICE_ID_SIZE];
+    tego_user_type_t type;
+    // tego_user_status_none for users not in the host's contact list
+    tego_user_status_t status;
+} tego_user_record_t;
+
+/*
+ * Describe our users in a caller provided array, without allocating
+ *
+ * Users are enumerated in a fixed order: contacts, then users requesting
+ * to be contacts, then blocked users. This writes the first
+ * recordsBufferLength of them; use tego_context_get_user_records_from to
+ * walk a roster larger than the buffer.
+ *
+ * @param context : the current tego context
+ * @param out_recordsBuffer : destination array of user records
+ * @param recordsBufferLength : number of records out_recordsBuffer can hold
+ * @param out_recordCount : destination to store number of records written
+ * @param error : filled on error
+ */
+void tego_context_get_user_records(
+    const tego_context_t* context,
+    tego_user_record_t* out_recordsBuffer,
+    size_t recordsBufferLength,
+    size_t* out_recordCount,
+    tego_error_t** error);
+
+/*
+ * Describe our users incrementally, without allocating
+ *
+ * Continues the enumeration of tego_context_get_user_records from
+ * *inout_cursor, which should be 0 for the first call, and advances it
+ * past the records written. The enumeration is complete once fewer than
+ * recordsBufferLength records are written. The cursor is a position in
+ * the roster, so users added or removed between calls may be skipped or
+ * seen twice.
+ *
+ * @param context : the current tego context
+ * @param inout_cursor : position to continue from, advanced on return
+ * @param out_recordsBuffer : destination array of user records
+ * @param recordsBufferLength : number of records out_recordsBuffer can hold
+ * @param out_recordCount : destination to store number of records written
+ * @param error : filled on error
+ */
+void tego_context_get_user_records_from(
+    const tego_context_t* context,
+    size_t* inout_cursor,
+    tego_user_record_t* out_recordsBuffer,
+    size_t recordsBufferLength,
+    size_t* out_recordCount,
+    tego_error_t** error);
+
 //
 // Tor Config
 //
@@ -686,6 +743,31 @@ size_t tego_context_get_tor_logs(
     size_t logBufferSize,
     tego_error_t** error);
 
+/*
+ * Fill the passed in buffer with the tor daemon's log entries newer than a
+ * cursor, each followed by newline character '\n'
+ *
+ * Only the most recent entries are retained. Each entry has a sequence number,
+ * and the cursor is the sequence number to continue from: pass 0 on the first
+ * call, and the cursor is advanced past the entries written. Only whole entries
+ * are written, except that an entry too long for the whole buffer is cut
+ * short. Entries that were dropped before being read are skipped.
+ *
+ * @param context : the current tego context
+ * @param inout_cursor : sequence number to continue from, advanced on return
+ * @param out_logBuffer : user allocated buffer where tor log is to be written
+ * @param logBufferSize : the size of the passed in out_logBuffer buffer
+ * @param error : filled on error
+ * @return : the number of characters written (including null terminator) to
+ *  out_logBuffer
+ */
+size_t tego_context_get_tor_logs_since(
+    const tego_context_t* context,
+    uint64_t* inout_cursor,
+    char* out_logBuffer,
+    size_t logBufferSize,
+    tego_error_t** error);
+
 /*
  * Get the null-terminated tor version string
  *
@@ -820,6 +902,41 @@ void tego_context_get_tor_bootstrap_status(
     tego_tor_bootstrap_tag_t* out_tag,
     tego_error_t** error);
 
+// the locks libtego shares between threads
+typedef enum
+{
+    tego_lock_callback_queue,
+    tego_lock_file_hash_cache,
+} tego_lock_t;
+
+// how a lock has been used since the context was created
+typedef struct tego_lock_stats
+{
+    uint64_t acquisitions;
+    // acquisitions which had to wait for another thread to release the lock
+    uint64_t contended;
+    // time spent waiting for and holding the lock, in nanoseconds
+    uint64_t totalWaitNs;
+    uint64_t totalHoldNs;
+    uint64_t maxHoldNs;
+} tego_lock_stats_t;
+
+/*
+ * Get the usage counters of one of libtego's internal locks, e.g. to look
+ * for lock contention. Unlike most methods this may be called from any
+ * thread.
+ *
+ * @param context : the current tego context
+ * @param lock : the lock to query
+ * @param out_stats : destination to save the counters
+ * @param error : filled on error
+ */
+void tego_context_get_lock_stats(
+    const tego_context_t* context,
+    tego_lock_t lock,
+    tego_lock_stats_t* out_stats,
+    tego_error_t** error);
+
 //
 // Tego Chat Methods
 //
@@ -886,12 +1003,19 @@ void tego_context_send_message(
 /*
  * Request to send a file to the given user
  *
+ * Files are hashed on a background thread, and the request is sent to the
+ * user once the hash is ready. Hashes are remembered, so sending an unchanged
+ * file again does not re-read it. The hash is reported by the
+ * file_transfer_hashed callback; if hashing fails, the file_transfer_complete
+ * callback reports tego_file_transfer_result_filesystem_error instead.
+ *
  * @param context : the current tego context
  * @param user : the user to send a file to
  * @param filePath : utf8 path to file to send
  * @param filePathLength : length of filePath not including null-terminator
  * @param out_id : optional, filled with assigned file transfer id for callbacks
- * @param out_fileHash : optional, filled with hash of the file to send
+ * @param out_fileHash : optional, filled with hash of the file to send if it
+ *  is already known, otherwise set to NULL; this call never waits for hashing
  * @param out_fileSize : optional, filled with the size of the file in bytes
  * @param error : filled on error
  */
@@ -945,6 +1069,22 @@ void tego_context_cancel_file_transfer(
     tego_file_transfer_id_t id,
     tego_error_t** error);
 
+/*
+ * Sets how many bytes of file data may be sent ahead of the receiver's
+ * acknowledgements for each outgoing file transfer. Larger windows keep
+ * high-latency circuits busy at the cost of more buffered data. Applies
+ * to all transfers, including those already in progress.
+ *
+ * @param context : the current tego context
+ * @param windowSize : window size in bytes, must be at least 64512 bytes
+ *  (one file chunk); the default is 16 chunks
+ * @param error: filled on error
+ */
+void tego_context_set_file_transfer_window_size(
+    tego_context_t* context,
+    tego_file_size_t windowSize,
+    tego_error_t** error);
+
 /*
  * Sends a request to chat to a user
  *
@@ -1196,6 +1336,21 @@ typedef void (*tego_file_transfer_request_received_callback_t)(
     tego_file_size_t fileSize,
     tego_file_hash_t const* fileHash);
 
+/*
+ * Callback fired once a file we are sending has been hashed, shortly before
+ * the request is sent to the recipient
+ *
+ * @param context : the current tego context
+ * @param receiver : the user the file is being sent to
+ * @param id : the id of the file transfer
+ * @param fileHash : the hash of the file
+ */
+typedef void (*tego_file_transfer_hashed_callback_t)(
+    tego_context_t* context,
+    tego_user_id_t const* receiver,
+    tego_file_transfer_id_t id,
+    tego_file_hash_t const* fileHash);
+
 /*
  * Callback fired when a file transfer request message is received and
  * acknowledged by the recipient (not whether the recipient wishes to start
@@ -1372,6 +1527,11 @@ void tego_context_set_file_transfer_request_received_callback(
     tego_file_transfer_request_received_callback_t,
     tego_error_t** error);
 
+void tego_context_set_file_transfer_hashed_callback(
+    tego_context_t* context,
+    tego_file_transfer_hashed_callback_t,
+    tego_error_t** error);
+
 void tego_context_set_file_transfer_request_acknowledged_callback(
     tego_context_t* context,
     tego_file_transfer_request_acknowledged_callback_t,
@@ -12,6 +12,7 @@ using tego::g_globals;
 #include "tor/TorProcess.h"
 #include "core/UserIdentity.h"
 #include "core/ContactUser.h"
+#include "core/ServiceIdKey.h"
 #include "core/ConversationModel.h"
 #include "utils/SecureRNG.h"
 
@@ -39,32 +40,48 @@ void tego_context::start_tor(const tego_tor_launch_config_t* config)
 
 size_t tego_context::get_tor_logs_size() const
 {
-    size_t retval = 0;
-    for(const auto& msg : this->get_tor_logs())
-    {
-        retval += msg.size() + 1;
-    }
-    return retval;
+    // each entry followed by a newline
+    const auto& logs = this->get_tor_logs();
+    return logs.byteSize() + logs.size();
 }
 
-const std::vector<std::string>& tego_context::get_tor_logs() const
+const Tor::TorLogBuffer& tego_context::get_tor_logs() const
 {
     TEGO_THROW_IF_NULL(this->torManager);
+    return this->torManager->logs();
+}
+
+size_t tego_context::get_tor_logs_since(
+    uint64_t* inout_cursor,
+    char* out_logBuffer,
+    size_t logBufferSize) const
+{
+    TEGO_THROW_IF_FALSE(logBufferSize > 0);
 
-    auto logMessages = this->torManager->logMessages();
-    TEGO_THROW_IF_FALSE(logMessages.size() >= 0);
+    // leave room for the null terminator
+    const size_t capacity = logBufferSize - 1;
+    size_t written = 0;
 
-    // see if we need to update our local copy
-    if(static_cast<size_t>(logMessages.size()) != this->torLogs.size())
+    *inout_cursor = this->get_tor_logs().readSince(*inout_cursor, [&](uint64_t, std::string_view line) -> bool
     {
-        for(size_t i = this->torLogs.size(); i < static_cast<size_t>(logMessages.size()); i++)
+        if (line.size() + 1 > capacity - written)
         {
-            TEGO_THROW_IF_FALSE(i < std::numeric_limits<int>::max());
-            this->torLogs.push_back(logMessages[static_cast<int>(i)].toStdString());
+            // only whole entries are written, except for one too long to
+            // ever fit, which is cut short rather than stalling the cursor
+            if (written > 0 || capacity == 0)
+            {
+                return false;
+            }
+            line = line.substr(0, capacity - 1);
         }
-    }
-
-    return this->torLogs;
+        std::copy(line.begin(), line.end(), out_logBuffer + written);
+        written += line.size();
+        out_logBuffer[written++] = '\n';
+        return true;
+    });
+    out_logBuffer[written] = 0;
+
+    return written + 1;
 }
 
 const char* tego_context::get_tor_version_string() const
@@ -455,10 +472,9 @@ tego_message_id_t tego_context::send_message(
     return conversationModel->sendMessage(QString::fromStdString(message));
 }
 
-tego_user_type_t tego_context::get_user_type(tego_user_id_t const* user) const
+namespace
 {
-    auto contactUser = this->getContactUser(user);
-    if (contactUser != nullptr)
+    tego_user_type_t contactUserType(const ContactUser* contactUser)
     {
         auto const status = contactUser->status();
         switch(status)
@@ -471,9 +487,47 @@ tego_user_type_t tego_context::get_user_type(tego_user_id_t const* user) const
             case ContactUser::RequestRejected:
                 return tego_user_type_rejected;
             default:
-                TEGO_THROW_MSG("Unknown ContactUser::Status : {}", static_cast<int>(status));
                 break;
         }
+        TEGO_THROW_MSG("Unknown ContactUser::Status : {}", static_cast<int>(status));
+    }
+
+    tego_user_status_t contactUserStatus(const ContactUser* contactUser)
+    {
+        switch(contactUser->status())
+        {
+            case ContactUser::Online:
+                return tego_user_status_online;
+            case ContactUser::Offline:
+                return tego_user_status_offline;
+            default:
+                return tego_user_status_none;
+        }
+    }
+
+    template<typename HOSTNAME>
+    void fillUserRecord(
+        tego_user_record_t& record,
+        HOSTNAME const& hostname,
+        tego_user_type_t type,
+        tego_user_status_t status)
+    {
+        ServiceIdKey key;
+        TEGO_THROW_IF_FALSE(ServiceIdKey::fromHostname(hostname, key));
+
+        std::copy(key.bytes.begin(), key.bytes.end(), record.serviceId);
+        record.serviceId[TEGO_V3_ONION_SERVICE_ID_LENGTH] = 0;
+        record.type = type;
+        record.status = status;
+    }
+}
+
+tego_user_type_t tego_context::get_user_type(tego_user_id_t const* user) const
+{
+    auto contactUser = this->getContactUser(user);
+    if (contactUser != nullptr)
+    {
+        return contactUserType(contactUser);
     }
 
     // next check for requesting users
@@ -573,6 +627,53 @@ std::vector<tego_user_id_t*> tego_context::get_users() const
     return users;
 }
 
+size_t tego_context::get_user_records(
+    size_t first,
+    tego_user_record_t* out_records,
+    size_t recordsLength) const
+{
+    TEGO_THROW_IF_NULL(this->identityManager);
+    auto userIdentity = this->identityManager->identities().first();
+    auto contactsManager = userIdentity->getContacts();
+    auto incomingRequestManager = contactsManager->incomingRequestManager();
+
+    // users are enumerated in the same order as get_users(); position is the
+    // roster index of the start of the current section, so whole sections
+    // before first are skipped without being looked at. Every section is a
+    // QList, so skipping into one is constant time as well
+    size_t position = 0;
+    size_t written = 0;
+    auto fillSection = [&](auto const& section, auto&& fill) -> void
+    {
+        const auto sectionSize = static_cast<size_t>(section.size());
+        if (written < recordsLength && first < position + sectionSize)
+        {
+            auto it = section.begin();
+            std::advance(it, first > position ? first - position : 0);
+            for(; it != section.end() && written < recordsLength; ++it)
+            {
+                fill(out_records[written++], *it);
+            }
+        }
+        position += sectionSize;
+    };
+
+    fillSection(contactsManager->contacts(), [](tego_user_record_t& record, const ContactUser* contactUser)
+    {
+        fillUserRecord(record, contactUser->hostname(), contactUserType(contactUser), contactUserStatus(contactUser));
+    });
+    fillSection(incomingRequestManager->requests(), [](tego_user_record_t& record, const IncomingContactRequest* request)
+    {
+        fillUserRecord(record, request->hostname(), tego_user_type_requesting, tego_user_status_none);
+    });
+    fillSection(incomingRequestManager->rejectedHostnames(), [](tego_user_record_t& record, QByteArray const& hostname)
+    {
+        fillUserRecord(record, hostname, tego_user_type_blocked, tego_user_status_none);
+    });
+
+    return written;
+}
+
 void tego_context::forget_user(const tego_user_id_t* user)
 {
     // TODO: does not handle our blocked users or incoming request users
@@ -581,7 +682,7 @@ void tego_context::forget_user(const tego_user_id_t* user)
     contactUser->deleteContact();
 }
 
-std::tuple<tego_file_transfer_id_t, std::unique_ptr<tego_file_hash_t>, tego_file_size_t> tego_context::send_file_transfer_request(
+std::tuple<tego_file_transfer_id_t, std::shared_future<tego_file_hash_t>, tego_file_size_t> tego_context::send_file_transfer_request(
     tego_user_id_t const* user,
     std::string const& filePath)
 {
@@ -641,6 +742,18 @@ void tego_context::cancel_file_transfer_transfer(
     conversationModel->cancelTransfer(fileTransfer);
 }
 
+void tego_context::set_file_transfer_window_size(tego_file_size_t windowSize)
+{
+    // we always need to be able to send at least one chunk
+    TEGO_THROW_IF_FALSE(windowSize >= Protocol::FileChannel::FileMaxChunkSize);
+    this->fileTransferWindowSize = windowSize;
+}
+
+tego_file_size_t tego_context::get_file_transfer_window_size() const
+{
+    return this->fileTransferWindowSize;
+}
+
 //
 // tego_context private methods
 //
@@ -776,35 +889,48 @@ extern "C"
                 return 0;
             }
 
-            // get our tor logs
-            const auto& logs = context->get_tor_logs();
-            size_t logsSize = context->get_tor_logs_size();
+            // copy each log entry followed by a new line '\n' straight into
+            // the caller's buffer, keeping the last byte for the null terminator
+            const size_t capacity = logBufferSize - 1;
+            size_t written = 0;
+            context->get_tor_logs().readSince(0, [&](uint64_t, std::string_view line) -> bool
+            {
+                const size_t lineCount = std::min(line.size(), capacity - written);
+                std::copy_n(line.data(), lineCount, out_logBuffer + written);
+                written += lineCount;
+                if (written < capacity)
+                {
+                    out_logBuffer[written++] = '\n';
+                }
+                return written < capacity;
+            });
+            out_logBuffer[written] = 0;
+
+            return written + 1;
+        }, error, 0);
+    }
 
-            // create temporary buffer to copy each line into
-            std::vector<char> logBuffer;
-            logBuffer.reserve(logsSize);
+    size_t tego_context_get_tor_logs_since(
+        const tego_context_t* context,
+        uint64_t* inout_cursor,
+        char* out_logBuffer,
+        size_t logBufferSize,
+        tego_error_t** error)
+    {
+        return tego::translateExceptions([=]() -> size_t
+        {
+            TEGO_THROW_IF_NULL(context);
+            TEGO_THROW_IF_FALSE(context->threadId == std::this_thread::get_id());
+            TEGO_THROW_IF_NULL(inout_cursor);
+            TEGO_THROW_IF_NULL(out_logBuffer);
 
-            // copy each log and separate by new lines '\n'
-            for(const auto& line : logs)
+            // nothing to do if no space to write
+            if (logBufferSize == 0)
             {
-                std::copy(line.begin(), line.end(), std::back_inserter(logBuffer));
-                logBuffer.push_back('\n');
+                return 0;
             }
-            // append null terminator
-            logBuffer.push_back(0);
 
-            // finally copy at most logBufferSize bytes from logBuffer
-            size_t copyCount = std::min(logBufferSize, logBuffer.size());
-            TEGO_THROW_IF_FALSE(copyCount > 0);
-
-            // check that we won't overflow
-            TEGO_THROW_IF_FALSE(copyCount < std::numeric_limits<long>::max());
-
-            std::copy(logBuffer.begin(), logBuffer.begin() + static_cast<long>(copyCount), out_logBuffer);
-            // always write null terminator at the end
-            out_logBuffer[copyCount - 1] = 0;
-
-            return copyCount;
+            return context->get_tor_logs_since(inout_cursor, out_logBuffer, logBufferSize);
         }, error, 0);
     }
 
@@ -890,6 +1016,39 @@ extern "C"
         }, error);
     }
 
+    void tego_context_get_lock_stats(
+        const tego_context_t* context,
+        tego_lock_t lock,
+        tego_lock_stats_t* out_stats,
+        tego_error_t** error)
+    {
+        return tego::translateExceptions([=]() -> void
+        {
+            TEGO_THROW_IF_NULL(context);
+            TEGO_THROW_IF_NULL(out_stats);
+
+            // the counters are atomic, so no need to be on the context's thread
+            tego::lock_stats stats;
+            switch(lock)
+            {
+                case tego_lock_callback_queue:
+                    stats = context->callback_queue_.lock_stats();
+                    break;
+                case tego_lock_file_hash_cache:
+                    stats = context->file_hash_cache_.lock_stats();
+                    break;
+                default:
+                    TEGO_THROW_MSG("invalid lock : {}", static_cast<int>(lock));
+            }
+
+            out_stats->acquisitions = stats.acquisitions;
+            out_stats->contended = stats.contended;
+            out_stats->totalWaitNs = stats.total_wait;
+            out_stats->totalHoldNs = stats.total_hold;
+            out_stats->maxHoldNs = stats.max_hold;
+        }, error);
+    }
+
     void tego_context_start_service(
         tego_context_t* context,
         tego_ed25519_private_key_t const* hostPrivateKey,
@@ -1042,6 +1201,46 @@ extern "C"
         }, error);
     }
 
+    void tego_context_get_user_records(
+        const tego_context_t* context,
+        tego_user_record_t* out_recordsBuffer,
+        size_t recordsBufferLength,
+        size_t* out_recordCount,
+        tego_error_t** error)
+    {
+        return tego::translateExceptions([=]() -> void
+        {
+            TEGO_THROW_IF_NULL(context);
+            TEGO_THROW_IF_FALSE(context->threadId == std::this_thread::get_id());
+            TEGO_THROW_IF_FALSE(out_recordsBuffer != nullptr || recordsBufferLength == 0);
+            TEGO_THROW_IF_NULL(out_recordCount);
+
+            *out_recordCount = context->get_user_records(0, out_recordsBuffer, recordsBufferLength);
+        }, error);
+    }
+
+    void tego_context_get_user_records_from(
+        const tego_context_t* context,
+        size_t* inout_cursor,
+        tego_user_record_t* out_recordsBuffer,
+        size_t recordsBufferLength,
+        size_t* out_recordCount,
+        tego_error_t** error)
+    {
+        return tego::translateExceptions([=]() -> void
+        {
+            TEGO_THROW_IF_NULL(context);
+            TEGO_THROW_IF_FALSE(context->threadId == std::this_thread::get_id());
+            TEGO_THROW_IF_NULL(inout_cursor);
+            TEGO_THROW_IF_FALSE(out_recordsBuffer != nullptr || recordsBufferLength == 0);
+            TEGO_THROW_IF_NULL(out_recordCount);
+
+            auto recordCount = context->get_user_records(*inout_cursor, out_recordsBuffer, recordsBufferLength);
+            *inout_cursor += recordCount;
+            *out_recordCount = recordCount;
+        }, error);
+    }
+
     void tego_context_send_chat_request(
         tego_context_t* context,
         const tego_user_id_t* user,
@@ -1104,7 +1303,19 @@ extern "C"
             }
             if (out_fileHash != nullptr)
             {
-                *out_fileHash = fileHash.release();
+                // never wait for hashing here, the file_transfer_hashed
+                // callback reports the hash once it is ready
+                *out_fileHash = nullptr;
+                if (fileHash.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                {
+                    try
+                    {
+                        *out_fileHash = std::make_unique<tego_file_hash_t>(fileHash.get()).release();
+                    }
+                    // hashing failed after the request was queued, which the
+                    // file_transfer_complete callback reports
+                    catch(const std::exception&) {}
+                }
             }
             if (out_fileSize != nullptr)
             {
@@ -1158,6 +1369,20 @@ extern "C"
         }, error);
     }
 
+    void tego_context_set_file_transfer_window_size(
+        tego_context_t* context,
+        tego_file_size_t windowSize,
+        tego_error_t** error)
+    {
+        return tego::translateExceptions([=]() -> void
+        {
+            TEGO_THROW_IF_NULL(context);
+            TEGO_THROW_IF_FALSE(context->threadId == std::this_thread::get_id());
+
+            context->set_file_transfer_window_size(windowSize);
+        }, error);
+    }
+
     void tego_context_send_message(
         tego_context_t* context,
         const tego_user_id_t* user,
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "signals.hpp"
+#include "file_hash_cache.hpp"
 #include "tor.hpp"
 #include "user.hpp"
 
 #include "tor/TorControl.h"
 #include "tor/TorManager.h"
+#include "tor/TorLogBuffer.h"
 #include "core/IdentityManager.h"
+#include "protocol/FileChannel.h"
 
 //
 // Tego Context
@@ -20,7 +23,11 @@ public:
     void start_tor(const tego_tor_launch_config_t* config);
     bool get_tor_daemon_configured() const;
     size_t get_tor_logs_size() const;
-    const std::vector<std::string>& get_tor_logs() const;
+    const Tor::TorLogBuffer& get_tor_logs() const;
+    size_t get_tor_logs_since(
+        uint64_t* inout_cursor,
+        char* out_logBuffer,
+        size_t logBufferSize) const;
     const char* get_tor_version_string() const;
     tego_tor_control_status_t get_tor_control_status() const;
     tego_tor_process_status_t get_tor_process_status() const;
@@ -52,8 +59,12 @@ public:
     tego_user_type_t get_user_type(tego_user_id_t const* user) const;
     size_t get_user_count() const;
     std::vector<tego_user_id_t*> get_users() const;
+    size_t get_user_records(
+        size_t first,
+        tego_user_record_t* out_records,
+        size_t recordsLength) const;
     void forget_user(const tego_user_id_t* user);
-    std::tuple<tego_file_transfer_id_t, std::unique_ptr<tego_file_hash_t>, tego_file_size_t> send_file_transfer_request(
+    std::tuple<tego_file_transfer_id_t, std::shared_future<tego_file_hash_t>, tego_file_size_t> send_file_transfer_request(
         tego_user_id_t const* user,
         std::string const& filePath);
     void respond_file_transfer_request(
@@ -64,12 +75,18 @@ public:
     void cancel_file_transfer_transfer(
         tego_user_id_t const* user,
         tego_file_transfer_id_t);
+    void set_file_transfer_window_size(tego_file_size_t windowSize);
+    tego_file_size_t get_file_transfer_window_size() const;
 
     tego::callback_registry callback_registry_;
     tego::callback_queue callback_queue_;
-    // anything that touches internal state should do so through
-    // this 'global' (actually per tego_context) mutex
-    std::mutex mutex_;
+    tego::file_hash_cache file_hash_cache_;
+
+    // there is no context wide lock: Tor status, contacts, conversations and
+    // file transfers all live in Qt objects owned by the thread below, which
+    // every entry point checks for. Only the callback queue and the file hash
+    // cache are shared with other threads, and they lock (and measure) on
+    // their own
 
     // TODO: figure out ownership of these Qt types
     Tor::TorManager* torManager = nullptr;
@@ -86,6 +103,6 @@ private:
     class ContactUser* getContactUser(const tego_user_id_t*) const;
 
     mutable std::string torVersion;
-    mutable std::vector<std::string> torLogs;
     tego_host_onion_service_state_t hostUserState = tego_host_onion_service_state_none;
+    tego_file_size_t fileTransferWindowSize = Protocol::FileChannel::FileDefaultWindowSize;
 };
\ No newline at end of file
@@ -52,6 +52,7 @@ ContactUser::ContactUser(UserIdentity *ident, const QString& hostname, Status st
     , m_connection(0)
     , m_outgoingSocket(0)
     , m_status(status)
+    , m_lastOnline(0)
     , m_lastReceivedChatID(0)
     , m_contactRequest(0)
     , m_conversation(0)
@@ -125,6 +126,9 @@ void ContactUser::updateStatus()
         }
 
     }
+    // going offline is what counts: that is when it starts reconnecting
+    if (m_status == Online)
+        m_lastOnline = QDateTime::currentMSecsSinceEpoch();
     m_status = newStatus;
     emit statusChanged();
 
@@ -164,6 +168,8 @@ void ContactUser::updateOutgoingSocket()
         );
     }
 
+    // contacts that were online recently reconnect first after a network blip
+    m_outgoingSocket->setPriority(m_lastOnline);
     m_outgoingSocket->connectToHost(hostname(), port());
 }
 
@@ -235,7 +241,10 @@ void ContactUser::setHostname(const QString &hostname)
     if (!hostname.endsWith(QLatin1String(".onion")))
         fh.append(QLatin1String(".onion"));
 
-    m_hostname = hostname;
+    if (fh != m_hostname) {
+        m_hostname = fh;
+        emit hostnameChanged();
+    }
 
     updateOutgoingSocket();
 }
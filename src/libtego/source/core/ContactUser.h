@@ -119,6 +119,7 @@ signals:
     void connectionChanged(const QWeakPointer<Protocol::Connection> &connection);
 
     void nicknameChanged();
+    void hostnameChanged();
     void contactDeleted(ContactUser *user);
 
 private slots:
@@ -132,6 +133,8 @@ private:
     Protocol::OutboundConnector *m_outgoingSocket;
 
     Status m_status;
+    // when the contact was last seen online this session, in ms since the epoch
+    qint64 m_lastOnline;
     quint16 m_lastReceivedChatID;
     OutgoingContactRequest *m_contactRequest;
     ConversationModel *m_conversation;
@@ -53,7 +53,7 @@ void ContactsManager::addAllowedContacts(const QList<QString>& userHostnames)
     {
         ContactUser *user = new ContactUser(identity, hostname, ContactUser::Offline, this);
         connectSignals(user);
-        pContacts.append(user);
+        insertContact(user);
         emit contactAdded(user);
     }
 }
@@ -90,7 +90,7 @@ void ContactsManager::addRejectedOutgoingRequests(const QList<QString>& userHost
         ContactUser *user = new ContactUser(identity, hostname, ContactUser::RequestRejected, this);
 
         connect(user, SIGNAL(contactDeleted(ContactUser*)), SLOT(contactDeleted(ContactUser*)));
-        pContacts.append(user);
+        insertContact(user);
 
         // emit contactAdded(user);
     }
@@ -104,7 +104,7 @@ ContactUser *ContactsManager::addContact(const QString& hostname)
 
     qDebug() << "Added new contact" << hostname;
 
-    pContacts.append(user);
+    insertContact(user);
     emit contactAdded(user);
 
     return user;
@@ -147,24 +147,69 @@ ContactUser *ContactsManager::createContactRequest(const QString &contactid, con
 void ContactsManager::contactDeleted(ContactUser *user)
 {
     pContacts.removeOne(user);
+    unindexContact(user);
 }
 
-ContactUser *ContactsManager::lookupHostname(const QString &hostname) const
+void ContactsManager::insertContact(ContactUser *user)
 {
-    QString ohost = ContactIDValidator::hostnameFromID(hostname);
-    if (ohost.isNull())
-        ohost = hostname;
+    pContacts.append(user);
+    indexContact(user);
+
+    connect(user, &ContactUser::hostnameChanged, this,
+        [this,user]() {
+            unindexContact(user);
+            indexContact(user);
+        }
+    );
+}
 
-    if (!ohost.endsWith(QLatin1String(".onion")))
-        ohost.append(QLatin1String(".onion"));
+void ContactsManager::indexContact(ContactUser *user)
+{
+    ServiceIdKey key;
+    if (!ServiceIdKey::fromHostname(user->hostname(), key))
+    {
+        qWarning() << "Contact has an invalid hostname and cannot be looked up:" << user->hostname();
+        return;
+    }
 
-    for (QList<ContactUser*>::ConstIterator it = pContacts.begin(); it != pContacts.end(); ++it)
+    indexedServiceIds.insert(user, key);
+    contactsByServiceId.emplace(key, user);
+}
+
+void ContactsManager::unindexContact(ContactUser *user)
+{
+    auto indexed = indexedServiceIds.find(user);
+    if (indexed == indexedServiceIds.end())
+        return;
+
+    const ServiceIdKey key = indexed.value();
+    indexedServiceIds.erase(indexed);
+
+    auto it = contactsByServiceId.find(key);
+    if (it == contactsByServiceId.end() || it->second != user)
+        return;
+    contactsByServiceId.erase(it);
+
+    // another contact with the same id may have been shadowed by this one
+    for (ContactUser *other : std::as_const(pContacts))
     {
-        if (ohost.compare((*it)->hostname(), Qt::CaseInsensitive) == 0)
-            return *it;
+        auto otherKey = indexedServiceIds.find(other);
+        if (otherKey != indexedServiceIds.end() && otherKey.value() == key)
+        {
+            contactsByServiceId.emplace(key, other);
+            break;
+        }
     }
+}
+
+ContactUser *ContactsManager::lookupHostname(const QString &hostname) const
+{
+    ServiceIdKey key;
+    if (!ServiceIdKey::fromHostname(hostname, key))
+        return 0;
 
-    return 0;
+    auto it = contactsByServiceId.find(key);
+    return it != contactsByServiceId.end() ? it->second : 0;
 }
 
 void ContactsManager::onUnreadCountChanged()
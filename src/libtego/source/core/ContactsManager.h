@@ -34,6 +34,9 @@
 #define CONTACTSMANAGER_H
 
 #include "core/IncomingRequestManager.h"
+#include "core/ServiceIdKey.h"
+
+#include <unordered_map>
 
 class OutgoingContactRequest;
 class UserIdentity;
@@ -94,8 +97,15 @@ private slots:
 
 private:
     QList<ContactUser*> pContacts;
+    // contacts by service id, for lookupHostname; the first contact added wins
+    std::unordered_map<ServiceIdKey, ContactUser*, ServiceIdKey::Hash> contactsByServiceId;
+    // the key each contact is indexed under, so renames and deletes can find it
+    QHash<ContactUser*, ServiceIdKey> indexedServiceIds;
 
     void connectSignals(ContactUser *user);
+    void insertContact(ContactUser *user);
+    void indexContact(ContactUser *user);
+    void unindexContact(ContactUser *user);
 };
 
 #endif // CONTACTSMANAGER_H
@@ -122,31 +122,35 @@ template<typename T> T *findOrCreateChannelForContact(ContactUser *contact, Prot
 }
 
 
-std::tuple<tego_file_transfer_id_t, std::unique_ptr<tego_file_hash_t>, tego_file_size_t> ConversationModel::sendFile(const QString &file_uri)
+std::tuple<tego_file_transfer_id_t, std::shared_future<tego_file_hash_t>, tego_file_size_t> ConversationModel::sendFile(const QString &file_uri)
 {
     logger::println("Sending file: {}", file_uri);
 
     MessageData message(File, file_uri, QDateTime::currentDateTime(), lastMessageId++, Queued);
     message.type = ConversationModel::MessageType::File;
 
-    std::unique_ptr<tego_file_hash_t> fileHash;
+    // calculate our file hash off of the event loop, throws if the file can't be opened
+    const auto id = message.identifier;
+    auto fileHash = g_globals.context->file_hash_cache_.hash_file(file_uri, this, [this, id]() -> void
+    {
+        this->onFileHashed(id);
+    });
 
-    // calculate our file hash
-    if(std::ifstream file(file_uri.toStdString(), std::ios::in | std::ios::binary); file.is_open())
+    if (fileHash.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
     {
-        fileHash = std::make_unique<tego_file_hash_t>(file);
-        // copy for our message
-        message.fileHash = *fileHash;
+        // we've already hashed this file
+        message.fileHash = fileHash.get();
     }
     else
     {
-        TEGO_THROW_MSG("Could not open file {}", file_uri);
+        // the request gets sent from onFileHashed
+        message.pendingFileHash = fileHash;
     }
 
 	// calculate file size
     const tego_file_size_t fileSize = static_cast<tego_file_size_t>(QFileInfo(file_uri).size());
 
-    if (m_contact->connection())
+    if (!message.pendingFileHash.valid() && m_contact->connection())
     {
         logger::trace();
         auto channel = findOrCreateChannelForContact<Protocol::FileChannel>(m_contact, Protocol::Channel::Outbound);
@@ -176,9 +180,56 @@ std::tuple<tego_file_transfer_id_t, std::unique_ptr<tego_file_hash_t>, tego_file
     endInsertRows();
     prune();
 
+    if (!message.pendingFileHash.valid())
+        emitFileHashed(message.identifier, message.fileHash);
+
     return {message.identifier, std::move(fileHash), fileSize};
 }
 
+void ConversationModel::onFileHashed(MessageId id)
+{
+    // the transfer may have been cancelled or already sent in the meantime
+    const int row = indexOfIdentifier(id, true);
+    if (row < 0 || !messages[row].pendingFileHash.valid())
+        return;
+
+    MessageData &message = messages[row];
+    auto pendingFileHash = std::move(message.pendingFileHash);
+    message.pendingFileHash = {};
+
+    try
+    {
+        message.fileHash = pendingFileHash.get();
+    }
+    catch(const std::exception& ex)
+    {
+        qWarning() << "Failed to hash file" << message.text << ":" << ex.what();
+        message.status = Error;
+        emit dataChanged(index(row, 0), index(row, 0));
+
+        auto userId = this->contact()->toTegoUserId();
+        g_globals.context->callback_registry_.emit_file_transfer_complete(
+            userId.release(),
+            id,
+            tego_file_transfer_direction_sending,
+            tego_file_transfer_result_filesystem_error);
+        return;
+    }
+
+    emitFileHashed(id, message.fileHash);
+    sendQueuedMessages();
+}
+
+void ConversationModel::emitFileHashed(MessageId id, const tego_file_hash_t &fileHash)
+{
+    auto userId = this->contact()->toTegoUserId();
+    auto heapHash = std::make_unique<tego_file_hash_t>(fileHash);
+    g_globals.context->callback_registry_.emit_file_transfer_hashed(
+        userId.release(),
+        id,
+        heapHash.release());
+}
+
 tego_message_id_t ConversationModel::sendMessage(const QString &text)
 {
     if (text.isEmpty())
@@ -233,7 +284,13 @@ void ConversationModel::rejectFile(tego_file_transfer_id_t id)
 
 void ConversationModel::cancelTransfer(tego_file_transfer_id_t id)
 {
-    if(m_contact->connection())
+    // transfers still being hashed haven't been sent to anyone yet
+    if(auto it = std::find_if(messages.begin(), messages.end(), [=](auto& msg) {return msg.identifier == id && msg.pendingFileHash.valid();});
+       it != messages.end())
+    {
+        messages.erase(it);
+    }
+    else if(m_contact->connection())
     {
         // first try cancelling an inbound transfer
         if (auto channel = findOrCreateChannelForContact<Protocol::FileChannel>(m_contact, Protocol::Channel::Inbound);
@@ -294,7 +351,7 @@ void ConversationModel::sendQueuedMessages()
                     }
                     break;
                 case ConversationModel::MessageType::File:
-                    if (file_channel->isOpened())
+                    if (file_channel->isOpened() && !m.pendingFileHash.valid())
                     {
                         logger::println("Attempted to send queued file: {}", m.text);
                         m.status = file_channel->sendFileWithId(m.text, m.fileHash, m.time, m.identifier) ? Sending : Error;
@@ -79,7 +79,7 @@ public:
     virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
     virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
 
-    std::tuple<tego_file_transfer_id_t, std::unique_ptr<tego_file_hash_t>, tego_file_size_t> sendFile(const QString &file_url);
+    std::tuple<tego_file_transfer_id_t, std::shared_future<tego_file_hash_t>, tego_file_size_t> sendFile(const QString &file_url);
     tego_message_id_t sendMessage(const QString &text);
 
     void acceptFile(tego_file_transfer_id_t id, const std::string& dest);
@@ -110,6 +110,8 @@ private:
         MessageType type;
         QString text;
         tego_file_hash_t fileHash;
+        // valid while the file is still being hashed; the transfer request is held back until then
+        std::shared_future<tego_file_hash_t> pendingFileHash;
         QDateTime time;
         MessageId identifier;
         MessageStatus status;
@@ -129,6 +131,8 @@ private:
     // re-send. Start at a random ID to reduce chance of collisions, then increment
     MessageId lastMessageId;
 
+    void onFileHashed(MessageId identifier);
+    void emitFileHashed(MessageId identifier, const tego_file_hash_t &fileHash);
     int indexOfIdentifier(MessageId identifier, bool isOutgoing) const;
     void prune();
 };
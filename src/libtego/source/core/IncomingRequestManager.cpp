@@ -190,7 +190,11 @@ void IncomingRequestManager::removeRequest(IncomingContactRequest *request)
 
 void IncomingRequestManager::addRejectedHost(const QByteArray &hostname)
 {
+    if (this->rejectedHosts.contains(hostname))
+        return;
+
     this->rejectedHosts.insert(hostname);
+    this->rejectedHostList.append(hostname);
 }
 
 bool IncomingRequestManager::isHostnameRejected(const QByteArray &hostname) const
@@ -200,7 +204,7 @@ bool IncomingRequestManager::isHostnameRejected(const QByteArray &hostname) cons
 
 QList<QByteArray> IncomingRequestManager::getRejectedHostnames() const
 {
-    return this->rejectedHosts.values();
+    return this->rejectedHostList;
 }
 
 IncomingContactRequest::IncomingContactRequest(IncomingRequestManager *m, const QByteArray &h
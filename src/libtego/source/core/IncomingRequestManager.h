@@ -131,6 +131,8 @@ public:
     void addRejectedHost(const QByteArray &hostname);
     bool isHostnameRejected(const QByteArray &hostname) const;
     QList<QByteArray> getRejectedHostnames() const;
+    /* In the order they were rejected, so it can be indexed into */
+    const QList<QByteArray> &rejectedHostnames() const { return rejectedHostList; }
 
 signals:
     void requestAdded(IncomingContactRequest *request);
@@ -143,6 +145,8 @@ private slots:
 private:
     QList<IncomingContactRequest*> m_requests;
     QSet<QByteArray> rejectedHosts;
+    // the same hosts as rejectedHosts; entries are never removed
+    QList<QByteArray> rejectedHostList;
 
     void removeRequest(IncomingContactRequest *request);
 };
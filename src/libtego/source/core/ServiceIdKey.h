@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <tego/tego.h>
+
+#include <array>
+#include <functional>
+#include <string_view>
+
+/* A v3 onion service id as a fixed size, lower case binary key, for
+ * indexing contacts without building or comparing QStrings.
+ *
+ * fromHostname() accepts the forms used around libtego: a bare service
+ * id, a hostname ending in .onion, or a ricochet: contact id. */
+struct ServiceIdKey
+{
+    std::array<char, TEGO_V3_ONION_SERVICE_ID_LENGTH> bytes{};
+
+    bool operator==(const ServiceIdKey &other) const { return bytes == other.bytes; }
+    bool operator!=(const ServiceIdKey &other) const { return bytes != other.bytes; }
+
+    std::string_view view() const { return std::string_view(bytes.data(), bytes.size()); }
+
+    static bool fromHostname(const QString &hostname, ServiceIdKey &key)
+    {
+        static const QLatin1String prefix("ricochet:");
+        static const QLatin1String suffix(".onion");
+
+        qsizetype begin = 0;
+        qsizetype end = hostname.size();
+        if (hostname.startsWith(prefix))
+            begin = prefix.size();
+        else if (hostname.endsWith(suffix, Qt::CaseInsensitive))
+            end -= suffix.size();
+
+        if (end - begin != TEGO_V3_ONION_SERVICE_ID_LENGTH)
+            return false;
+        return assign(hostname.constData() + begin, key);
+    }
+
+    /* Same as above, for the UTF-8 hostnames kept by IncomingRequestManager */
+    static bool fromHostname(const QByteArray &hostname, ServiceIdKey &key)
+    {
+        static const char prefix[] = "ricochet:";
+        static const char suffix[] = ".onion";
+        constexpr qsizetype suffixLength = sizeof(suffix) - 1;
+
+        qsizetype begin = 0;
+        qsizetype end = hostname.size();
+        if (hostname.startsWith(prefix))
+            begin = sizeof(prefix) - 1;
+        else if (end >= suffixLength && qstrnicmp(hostname.constData() + end - suffixLength, suffix, suffixLength) == 0)
+            end -= suffixLength;
+
+        if (end - begin != TEGO_V3_ONION_SERVICE_ID_LENGTH)
+            return false;
+        return assign(hostname.constData() + begin, key);
+    }
+
+    struct Hash
+    {
+        size_t operator()(const ServiceIdKey &key) const
+        {
+            return std::hash<std::string_view>()(key.view());
+        }
+    };
+
+private:
+    static char16_t code(QChar c) { return c.unicode(); }
+    static char16_t code(char c) { return static_cast<unsigned char>(c); }
+
+    template<typename Char>
+    static bool assign(const Char *chars, ServiceIdKey &key)
+    {
+        for (size_t i = 0; i < key.bytes.size(); ++i) {
+            const char16_t c = code(chars[i]);
+            if (c >= 0x80)
+                return false;
+            key.bytes[i] = static_cast<char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+        }
+        return true;
+    }
+};
@@ -1,19 +1,6 @@
 #include "file_hash.hpp"
 #include "error.hpp"
 
-// implements deleter for openssl's EVP_MD_CTX
-namespace std
-{
-    template<> class default_delete<::EVP_MD_CTX>
-    {
-    public:
-        void operator()(EVP_MD_CTX* val)
-        {
-            ::EVP_MD_CTX_free(val);
-        }
-    };
-}
-
 tego_file_hash::tego_file_hash()
 {
     TEGO_THROW_IF_FALSE(static_cast<size_t>(EVP_MD_size(EVP_sha3_512())) == data.size());
@@ -24,25 +11,15 @@ tego_file_hash::tego_file_hash()
 tego_file_hash::tego_file_hash(uint8_t const* begin, uint8_t const* end)
 : tego_file_hash()
 {
-    // init sha3 512 algo
-    std::unique_ptr<::EVP_MD_CTX> ctx(EVP_MD_CTX_new());
-    EVP_DigestInit_ex(ctx.get(), EVP_sha3_512(), nullptr);
-
-    // calc hash
-    EVP_DigestUpdate(ctx.get(), begin, static_cast<size_t>(end - begin));
-
-    // copy hash to our local buffer
-    uint32_t hashSize = 0;
-    EVP_DigestFinal_ex(ctx.get(), data.begin(), &hashSize);
-    TEGO_THROW_IF_FALSE(hashSize == this->DIGEST_SIZE);
+    tego_file_hasher hasher;
+    hasher.update(begin, end);
+    this->data = hasher.finalize().data;
 }
 
 tego_file_hash::tego_file_hash(std::istream& stream)
 : tego_file_hash()
 {
-    // init sha3 512 algo
-    std::unique_ptr<::EVP_MD_CTX> ctx(EVP_MD_CTX_new());
-    EVP_DigestInit_ex(ctx.get(), EVP_sha3_512(), nullptr);
+    tego_file_hasher hasher;
 
     // alloc a temp 64k buffer to read bytes into
     constexpr size_t BLOCK_SIZE = 65536;
@@ -57,13 +34,10 @@ tego_file_hash::tego_file_hash(std::istream& stream)
         TEGO_THROW_IF_FALSE_MSG(bytesRead <= BLOCK_SIZE, "Invalid amount of bytes read");
 
         // hash the block
-        EVP_DigestUpdate(ctx.get(), buffer.get(), bytesRead);
+        hasher.update(buffer.get(), buffer.get() + bytesRead);
     }
 
-    // copy hash to our local buffer
-    uint32_t hashSize = 0;
-    EVP_DigestFinal_ex(ctx.get(), data.begin(), &hashSize);
-    TEGO_THROW_IF_FALSE(hashSize == this->DIGEST_SIZE);
+    this->data = hasher.finalize().data;
 }
 
 constexpr size_t tego_file_hash::string_size() const
@@ -85,6 +59,45 @@ const std::string& tego_file_hash::to_string() const
     return hex;
 }
 
+//
+// Tego File Hasher
+//
+
+tego_file_hasher::tego_file_hasher()
+: ctx_(EVP_MD_CTX_new())
+{
+    // init sha3 512 algo
+    TEGO_THROW_IF_NULL(ctx_);
+    TEGO_THROW_IF_FALSE(EVP_DigestInit_ex(ctx_.get(), EVP_sha3_512(), nullptr) == 1);
+}
+
+void tego_file_hasher::update(uint8_t const* begin, uint8_t const* end)
+{
+    TEGO_THROW_IF_NULL(ctx_);
+    TEGO_THROW_IF_FALSE(EVP_DigestUpdate(ctx_.get(), begin, static_cast<size_t>(end - begin)) == 1);
+}
+
+void tego_file_hasher::update(char const* begin, char const* end)
+{
+    this->update(reinterpret_cast<uint8_t const*>(begin), reinterpret_cast<uint8_t const*>(end));
+}
+
+tego_file_hash tego_file_hasher::finalize()
+{
+    TEGO_THROW_IF_NULL(ctx_);
+
+    // copy hash to our result
+    tego_file_hash retval;
+    uint32_t hashSize = 0;
+    EVP_DigestFinal_ex(ctx_.get(), retval.data.begin(), &hashSize);
+    TEGO_THROW_IF_FALSE(hashSize == tego_file_hash::DIGEST_SIZE);
+
+    // a finalized context may not be updated again
+    ctx_.reset();
+
+    return retval;
+}
+
 extern "C"
 {
     size_t tego_file_hash_string_size(
@@ -1,5 +1,18 @@
 #pragma once
 
+// implements deleter for openssl's EVP_MD_CTX
+namespace std
+{
+    template<> class default_delete<::EVP_MD_CTX>
+    {
+    public:
+        void operator()(EVP_MD_CTX* val)
+        {
+            ::EVP_MD_CTX_free(val);
+        }
+    };
+}
+
 //
 // Tego File Hash
 //
@@ -23,4 +36,25 @@ struct tego_file_hash
     constexpr static size_t STRING_SIZE = STRING_LENGTH + 1;
     std::array<uint8_t, DIGEST_SIZE> data;
     mutable std::string hex;
-};
\ No newline at end of file
+};
+
+//
+// Tego File Hasher
+//
+
+// incrementally hashes blocks of bytes as they become available, so a file
+// can be verified without reading it back from disk
+class tego_file_hasher
+{
+public:
+    tego_file_hasher();
+
+    // hash the next block of bytes
+    void update(uint8_t const* begin, uint8_t const* end);
+    void update(char const* begin, char const* end);
+    // calculate the hash of all bytes seen so far, the hasher may not
+    // be updated afterwards
+    tego_file_hash finalize();
+private:
+    std::unique_ptr<::EVP_MD_CTX> ctx_;
+};
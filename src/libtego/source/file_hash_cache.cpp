@@ -0,0 +1,136 @@
+#include "file_hash_cache.hpp"
+#include "error.hpp"
+
+#ifndef Q_OS_WIN
+#include <sys/stat.h>
+#endif
+
+namespace tego
+{
+    file_hash_cache::file_hash_cache()
+    {
+        // hashing is mostly bound by disk throughput, so a handful of threads is plenty
+        pool_.setMaxThreadCount(std::clamp(QThread::idealThreadCount(), 1, 4));
+    }
+
+    std::shared_future<tego_file_hash> file_hash_cache::hash_file(
+        const QString& filePath,
+        QObject* receiver,
+        std::function<void()> onHashed)
+    {
+        QFileInfo fi(filePath);
+        const auto canonicalFilePath = fi.canonicalFilePath();
+        TEGO_THROW_IF_FALSE_MSG(fi.isFile() && !canonicalFilePath.isEmpty(), "Could not open file {}", filePath);
+
+        key k;
+        k.path = canonicalFilePath.toStdString();
+        k.size = fi.size();
+        k.modified = fi.lastModified().toMSecsSinceEpoch();
+        k.inode = 0;
+#ifndef Q_OS_WIN
+        // catches files replaced by rename with an identical size and timestamp
+        struct stat st = {};
+        if (::stat(k.path.c_str(), &st) == 0)
+        {
+            k.inode = static_cast<uint64_t>(st.st_ino);
+        }
+#endif
+
+        std::lock_guard<instrumented_mutex> lock(mutex_);
+
+        if (auto it = entries_.find(k); it != entries_.end())
+        {
+            auto& e = it->second;
+            if (receiver != nullptr &&
+                e.hash.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                e.listeners.emplace_back(receiver, std::move(onHashed));
+            }
+            return e.hash;
+        }
+
+        prune();
+
+        auto promise = std::make_shared<std::promise<tego_file_hash>>();
+        entry e;
+        e.hash = promise->get_future().share();
+        if (receiver != nullptr)
+        {
+            e.listeners.emplace_back(receiver, std::move(onHashed));
+        }
+        auto retval = e.hash;
+        entries_.emplace(k, std::move(e));
+
+        pool_.start([this, k = std::move(k), promise = std::move(promise)]() mutable -> void
+        {
+            this->hash_job(std::move(k), std::move(promise));
+        });
+
+        return retval;
+    }
+
+    void file_hash_cache::hash_job(key k, std::shared_ptr<std::promise<tego_file_hash>> promise)
+    {
+        std::exception_ptr failure;
+        try
+        {
+            std::ifstream file(k.path, std::ios::in | std::ios::binary);
+            TEGO_THROW_IF_FALSE_MSG(file.is_open(), "Could not open file {}", k.path);
+
+            promise->set_value(tego_file_hash(file));
+        }
+        catch(...)
+        {
+            failure = std::current_exception();
+        }
+
+        decltype(entry::listeners) listeners;
+        {
+            std::lock_guard<instrumented_mutex> lock(mutex_);
+            if (auto it = entries_.find(k); it != entries_.end())
+            {
+                std::swap(listeners, it->second.listeners);
+                // forget failures so the next request tries again, before
+                // anyone can see this one
+                if (failure)
+                {
+                    entries_.erase(it);
+                }
+            }
+        }
+        if (failure)
+        {
+            promise->set_exception(failure);
+        }
+
+        // receivers live on the event loop thread, so only check whether they
+        // still exist once we are back on it
+        for(auto& [receiver, onHashed] : listeners)
+        {
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(),
+                [receiver = std::move(receiver), onHashed = std::move(onHashed)]() -> void
+                {
+                    if (receiver)
+                    {
+                        onHashed();
+                    }
+                },
+                Qt::QueuedConnection);
+        }
+    }
+
+    void file_hash_cache::prune()
+    {
+        if (entries_.size() < MaxEntries)
+        {
+            return;
+        }
+
+        // keep in-flight entries, their jobs still need to find them
+        std::erase_if(entries_, [](const auto& pair) -> bool
+        {
+            return pair.second.hash.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "file_hash.hpp"
+#include "lock_stats.hpp"
+
+namespace tego
+{
+    /*
+     * file_hash_cache hashes files for outgoing transfers on a pool of worker
+     * threads so the Qt event loop is never blocked reading large files. Hashes
+     * are remembered for the lifetime of the context and keyed by the file's
+     * canonical path, size, modification time and inode, so sending the same
+     * unchanged file to many contacts only hashes it once.
+     */
+    class file_hash_cache
+    {
+    public:
+        // upper bound on remembered hashes, completed entries are dropped beyond this
+        constexpr static size_t MaxEntries = 4096;
+
+        file_hash_cache();
+
+        /*
+         * Returns a future for the hash of the file at filePath. A hash we have
+         * already computed for this version of the file is returned as a ready
+         * future; otherwise the file is hashed on a worker thread, and concurrent
+         * requests for the same file share that work.
+         *
+         * If the returned future is not yet ready, onHashed is queued to
+         * receiver's thread once it is (whether hashing succeeded or failed).
+         * The call is dropped if receiver has been destroyed by then.
+         */
+        std::shared_future<tego_file_hash> hash_file(
+            const QString& filePath,
+            QObject* receiver,
+            std::function<void()> onHashed);
+
+        // reported by tego_context_get_lock_stats
+        tego::lock_stats lock_stats() const { return mutex_.stats(); }
+
+    private:
+        struct key
+        {
+            std::string path;
+            int64_t size;
+            int64_t modified;
+            uint64_t inode;
+
+            auto operator<=>(const key&) const = default;
+        };
+
+        struct entry
+        {
+            std::shared_future<tego_file_hash> hash;
+            // receivers waiting for an in-flight hash
+            std::vector<std::pair<QPointer<QObject>, std::function<void()>>> listeners;
+        };
+
+        void hash_job(key k, std::shared_ptr<std::promise<tego_file_hash>> promise);
+        void prune();
+
+        instrumented_mutex mutex_{"file_hash_cache"};
+        // protected by mutex_, accessed from the event loop and worker threads
+        std::map<key, entry> entries_;
+
+        // pool must be last so that it is destroyed (and waits on any running
+        // jobs) before the entries they touch
+        QThreadPool pool_;
+    };
+}
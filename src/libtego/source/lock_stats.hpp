@@ -0,0 +1,122 @@
+#pragma once
+
+#include <tego/logger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace tego
+{
+    // counters kept by an instrumented_mutex, all times in nanoseconds
+    struct lock_stats
+    {
+        uint64_t acquisitions = 0;
+        // acquisitions that found the mutex already held
+        uint64_t contended = 0;
+        uint64_t total_wait = 0;
+        uint64_t total_hold = 0;
+        uint64_t max_hold = 0;
+    };
+
+    /*
+     * A std::mutex that keeps track of how often it is taken, how often that
+     * had to wait, and for how long it is held. Usable with std::lock_guard,
+     * std::unique_lock and std::condition_variable_any.
+     *
+     * The counters can be read at any time; they are written while the mutex
+     * is held and are logged when it is destroyed.
+     */
+    class instrumented_mutex
+    {
+    public:
+        explicit instrumented_mutex(const char* name)
+        : name_(name)
+        { }
+
+        ~instrumented_mutex()
+        {
+            const auto s = stats();
+            logger::println("lock '{}': {} acquisitions, {} contended, {} ns waiting, {} ns held (max {} ns)",
+                name_, s.acquisitions, s.contended, s.total_wait, s.total_hold, s.max_hold);
+        }
+
+        instrumented_mutex(const instrumented_mutex&) = delete;
+        instrumented_mutex& operator=(const instrumented_mutex&) = delete;
+
+        void lock()
+        {
+            if (!mutex_.try_lock())
+            {
+                const auto begin = clock::now();
+                mutex_.lock();
+                const auto acquired = clock::now();
+                contended_.fetch_add(1, std::memory_order_relaxed);
+                total_wait_.fetch_add(elapsed(begin, acquired), std::memory_order_relaxed);
+                on_acquired(acquired);
+                return;
+            }
+            on_acquired(clock::now());
+        }
+
+        bool try_lock()
+        {
+            if (!mutex_.try_lock())
+            {
+                return false;
+            }
+            on_acquired(clock::now());
+            return true;
+        }
+
+        void unlock()
+        {
+            const auto held = elapsed(acquired_, clock::now());
+            total_hold_.fetch_add(held, std::memory_order_relaxed);
+            if (held > max_hold_.load(std::memory_order_relaxed))
+            {
+                max_hold_.store(held, std::memory_order_relaxed);
+            }
+            mutex_.unlock();
+        }
+
+        lock_stats stats() const
+        {
+            lock_stats s;
+            s.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+            s.contended = contended_.load(std::memory_order_relaxed);
+            s.total_wait = total_wait_.load(std::memory_order_relaxed);
+            s.total_hold = total_hold_.load(std::memory_order_relaxed);
+            s.max_hold = max_hold_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        const char* name() const { return name_; }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        static uint64_t elapsed(clock::time_point begin, clock::time_point end)
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        }
+
+        void on_acquired(clock::time_point when)
+        {
+            acquisitions_.fetch_add(1, std::memory_order_relaxed);
+            acquired_ = when;
+        }
+
+        const char* name_;
+        std::mutex mutex_;
+        // protected by mutex_
+        clock::time_point acquired_;
+
+        std::atomic<uint64_t> acquisitions_{0};
+        std::atomic<uint64_t> contended_{0};
+        std::atomic<uint64_t> total_wait_{0};
+        std::atomic<uint64_t> total_hold_{0};
+        std::atomic<uint64_t> max_hold_{0};
+    };
+}
@@ -48,10 +48,12 @@ extern "C" {
 #include <array>
 #include <string_view>
 #include <cstdio>
+#include <cstring>
 #include <stdexcept>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
@@ -61,6 +63,9 @@ extern "C" {
 #include <tuple>
 #include <type_traits>
 #include <chrono>
+#include <functional>
+#include <future>
+#include <map>
 
 // fmt
 #include <fmt/format.h>
@@ -131,6 +136,8 @@ extern "C" {
 #include <QStringList>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QThread>
+#include <QThreadPool>
 #include <QtDebug>
 #include <QtEndian>
 #include <QtGlobal>
@@ -113,6 +113,16 @@ bool Channel::isOpened() const
     return d->isOpened;
 }
 
+Channel::Priority Channel::priority() const
+{
+    return Priority::Interactive;
+}
+
+bool Channel::isSendQueueFull()
+{
+    return connection()->d->isSendQueueFull();
+}
+
 bool Channel::openChannel()
 {
     Q_D(Channel);
@@ -276,6 +286,22 @@ bool Channel::sendPacket(const QByteArray &packet)
     return connection()->d->writePacket(this, packet);
 }
 
+char *Channel::beginPacket(int size)
+{
+    Q_D(Channel);
+    if (d->identifier < 0) {
+        TEGO_BUG() << "Cannot send packet to channel" << type() << "without an assigned identifier";
+        return nullptr;
+    }
+
+    if (size < 1) {
+        TEGO_BUG() << "Cannot send empty packet to channel" << type();
+        return nullptr;
+    }
+
+    return connection()->d->beginFrame(d->identifier, size);
+}
+
 void Channel::requestInboundApproval()
 {
     if (direction() != Channel::Inbound || isOpened()) {
@@ -78,6 +78,18 @@ public:
         Outbound
     };
 
+    /* Scheduling class for outbound packets
+     *
+     * When more data is queued than the connection can send, packets from
+     * higher priority channels are sent first, and channels of the same
+     * priority share the connection evenly.
+     */
+    enum class Priority {
+        Control,
+        Interactive,
+        Bulk
+    };
+
     /* Create a Channel instance of the specified type
      *
      * Returns null if 'type' is unrecognized.
@@ -89,6 +101,15 @@ public:
     Direction direction() const;
     Connection *connection();
     bool isOpened() const;
+    virtual Priority priority() const;
+
+    /* Returns true if the connection already has enough outbound data queued
+     *
+     * Channels producing bulk data should stop sending when this returns
+     * true, and continue once sendQueueDrained is emitted. Packets may still
+     * be sent; they are queued behind the existing data.
+     */
+    bool isSendQueueFull();
 
     /* Send the OpenChannel request for this channel
      *
@@ -121,6 +142,10 @@ signals:
      */
     void invalidated();
 
+    /* Emitted for Bulk priority channels when the connection's outbound
+     * queue has drained after isSendQueueFull returned true. */
+    void sendQueueDrained();
+
 public slots:
     void closeChannel();
 
@@ -176,6 +201,11 @@ protected:
      * Subclasses must implement this method to handle inbound packets for this
      * channel. 'packet' is raw data from the packet, and will not be empty.
      *
+     * 'packet' does not own its data; it points into the connection's read
+     * buffer and is only valid until this method returns. Implementations that
+     * need the bytes afterwards must make a deep copy, for example with
+     * QByteArray(packet.constData(), packet.size()).
+     *
      * Generally, a channel will parse packets using the protobuf ParseFromArray
      * method of their packet message type, and call appropriate handlers for
      * the messages it contains.
@@ -225,6 +255,12 @@ protected:
     void requestInboundApproval();
 
     QScopedPointer<ChannelPrivate> d_ptr;
+
+private:
+    /* Reserve space for a packet of 'size' bytes in the connection's pending
+     * frames, for sendMessage to serialize into. Returns nullptr in the cases
+     * where sendPacket would return false. */
+    char *beginPacket(int size);
 };
 
 }
@@ -82,15 +82,20 @@ template<typename T> bool Channel::sendMessage(const T &message)
         return false;
     }
 
-    QByteArray packet(int(size), 0);
-    quint8 *end = message.SerializeWithCachedSizesToArray(reinterpret_cast<quint8*>(packet.data()));
-    quint8 *expected_end = reinterpret_cast<quint8*>(packet.data() + size);
+    // Serialize straight into the connection's pending frames rather than an intermediate buffer
+    char *packet = beginPacket(int(size));
+    if (!packet)
+        return false;
+
+    quint8 *end = message.SerializeWithCachedSizesToArray(reinterpret_cast<quint8*>(packet));
+    quint8 *expected_end = reinterpret_cast<quint8*>(packet + size);
     if (end != expected_end) {
         TEGO_BUG() << "Unexpected packet size after message serialization. Expected" << size << "but got" << qptrdiff(end - expected_end);
+        connection()->d->abortFrame(identifier(), int(size));
         return false;
     }
 
-    return sendPacket(packet);
+    return true;
 }
 
 }
@@ -37,6 +37,13 @@
 
 using namespace Protocol;
 
+namespace
+{
+    // Frames are gathered here for a single socket write. The socket copies what it's given, so
+    // one buffer can serve every connection on a thread; idle connections then hold nothing.
+    thread_local QByteArray writeBuffer;
+}
+
 Connection::Connection(QTcpSocket *socket, Direction direction)
     : QObject()
     , d(new ConnectionPrivate(this))
@@ -52,6 +59,10 @@ ConnectionPrivate::ConnectionPrivate(Connection *qq)
     , purpose(Connection::Purpose::Unknown)
     , wasClosed(false)
     , handshakeDone(false)
+    , readBegin(0)
+    , readEnd(0)
+    , sendScheduler(SchedulerQuantum, SendQueueHighWaterMark, SendQueueLowWaterMark)
+    , flushScheduled(false)
     , nextOutboundChannelId(-1)
 {
     ageTimer.start();
@@ -151,6 +162,7 @@ void ConnectionPrivate::setSocket(QTcpSocket *s, Connection::Direction d)
     direction = d;
     connect(socket, &QAbstractSocket::disconnected, this, &ConnectionPrivate::socketDisconnected);
     connect(socket, &QIODevice::readyRead, this, &ConnectionPrivate::socketReadable);
+    connect(socket, &QIODevice::bytesWritten, this, &ConnectionPrivate::socketBytesWritten);
 
     socket->setParent(q);
 
@@ -195,6 +207,8 @@ void Connection::close()
     if (isConnected()) {
         Q_ASSERT(!d->wasClosed);
         qDebug() << "Disconnecting socket for connection" << this;
+        // Anything written before close should still go out ahead of the disconnect
+        d->flushWrites(true);
         d->socket->disconnectFromHost();
 
         // If not fully closed in 5 seconds, abort
@@ -209,6 +223,7 @@ void ConnectionPrivate::closeImmediately()
 {
     if (socket)
         socket->abort();
+    sendScheduler.clear();
 
     if (!wasClosed) {
         TEGO_BUG() << "Socket was forcefully closed but never emitted closed signal";
@@ -226,6 +241,7 @@ void ConnectionPrivate::closeImmediately()
 void ConnectionPrivate::socketDisconnected()
 {
     qDebug() << "Connection" << this << "disconnected";
+    sendScheduler.clear();
     // emit close signal first so FileChannel can bubble up errors
     if (!wasClosed) {
         wasClosed = true;
@@ -323,88 +339,83 @@ void ConnectionPrivate::socketReadable()
         }
     }
 
-    qint64 available;
-    while ((available = socket->bytesAvailable()) >= PacketHeaderSize) {
-        uchar header[PacketHeaderSize];
-        // Peek at the header first, to read the size of the packet and make sure
-        // the entire thing is available within the buffer.
-        qint64 re = socket->peek(reinterpret_cast<char*>(header), PacketHeaderSize);
+    Q_STATIC_ASSERT(ReadBufferSize >= 2 * UINT16_MAX);
+    if (readBuffer.isEmpty())
+        readBuffer.resize(ReadBufferSize);
+
+    while (socket->bytesAvailable() > 0) {
+        // Move any partial packet left over from the last read to the front of the buffer
+        if (readBegin > 0) {
+            std::memmove(readBuffer.data(), readBuffer.constData() + readBegin, static_cast<size_t>(readEnd - readBegin));
+            readEnd -= readBegin;
+            readBegin = 0;
+        }
+
+        // Read as much as fits in one go rather than a packet at a time
+        qint64 re = socket->read(readBuffer.data() + readEnd, readBuffer.size() - readEnd);
         if (re < 0) {
             qDebug() << "Connection socket error" << socket->error() << "during read:" << socket->errorString();
             socket->abort();
             return;
-        } else if (re < PacketHeaderSize) {
-            TEGO_BUG() << "Socket had" << available << "bytes available but peek only returned" << re;
+        } else if (re == 0) {
+            TEGO_BUG() << "Socket had" << socket->bytesAvailable() << "bytes available but read returned nothing";
             return;
         }
+        readEnd += static_cast<int>(re);
 
-        Q_STATIC_ASSERT(PacketHeaderSize == 4);
-        quint16 packetSize = qFromBigEndian<quint16>(header);
-        quint16 channelId = qFromBigEndian<quint16>(&header[2]);
+        while (readEnd - readBegin >= PacketHeaderSize) {
+            const uchar *header = reinterpret_cast<const uchar*>(readBuffer.constData() + readBegin);
 
-        if (packetSize < PacketHeaderSize) {
-            qWarning() << "Corrupted data from connection (packet size is too small); disconnecting";
-            socket->abort();
-            return;
-        }
+            Q_STATIC_ASSERT(PacketHeaderSize == 4);
+            quint16 packetSize = qFromBigEndian<quint16>(header);
+            quint16 channelId = qFromBigEndian<quint16>(&header[2]);
 
-        if (packetSize > available)
-            break;
+            if (packetSize < PacketHeaderSize) {
+                qWarning() << "Corrupted data from connection (packet size is too small); disconnecting";
+                socket->abort();
+                return;
+            }
 
-        // Read header out of the buffer and discard
-        re = socket->read(reinterpret_cast<char*>(header), PacketHeaderSize);
-        if (re != PacketHeaderSize) {
-            if (re < 0) {
-                qDebug() << "Connection socket error" << socket->error() << "during read:" << socket->errorString();
-            } else {
-                // Because of QTcpSocket buffering, we can expect that up to 'available' bytes
-                // will read. Treat anything less as an error condition.
-                TEGO_BUG() << "Socket read was unexpectedly small;" << available << "bytes should've been available but we read" << re;
+            if (packetSize > readEnd - readBegin)
+                break;
+
+            // Non-owning view of the packet data; it is only valid until we read into the buffer
+            // again, which can't happen before the channel has returned from receivePacket
+            const QByteArray data = QByteArray::fromRawData(readBuffer.constData() + readBegin + PacketHeaderSize,
+                                                            packetSize - PacketHeaderSize);
+            readBegin += packetSize;
+
+            Channel *channel = q->channel(channelId);
+            if (!channel) {
+                // XXX We should sanity-check and rate limit these responses better
+                if (data.isEmpty()) {
+                    qDebug() << "Ignoring channel close message for non-existent channel" << channelId;
+                } else {
+                    qDebug() << "Ignoring" << data.size() << "byte packet for non-existent channel" << channelId;
+                    // Send channel close message
+                    writePacket(channelId, QByteArray());
+                }
+                continue;
             }
-            socket->abort();
-            return;
-        }
 
-        // Read data
-        QByteArray data(packetSize - PacketHeaderSize, 0);
-        re = (data.size() == 0) ? 0 : socket->read(data.data(), data.size());
-        if (re != data.size()) {
-            if (re < 0) {
-                qDebug() << "Connection socket error" << socket->error() << "during read:" << socket->errorString();
-            } else {
-                // As above
-                TEGO_BUG() << "Socket read was unexpectedly small;" << available << "bytes should've been available but we read" << re;
+            if (channel->connection() != q) {
+                // If this fails, something is extremely broken. It may be dangerous to continue
+                // processing any data at all. Crash gracefully.
+                TEGO_BUG() << "Channel" << channelId << "found on connection" << this << "but its connection is"
+                      << channel->connection();
+                qFatal("Connection mismatch while handling packet");
+                return;
             }
-            socket->abort();
-            return;
-        }
 
-        Channel *channel = q->channel(channelId);
-        if (!channel) {
-            // XXX We should sanity-check and rate limit these responses better
             if (data.isEmpty()) {
-                qDebug() << "Ignoring channel close message for non-existent channel" << channelId;
+                channel->closeChannel();
             } else {
-                qDebug() << "Ignoring" << data.size() << "byte packet for non-existent channel" << channelId;
-                // Send channel close message
-                writePacket(channelId, QByteArray());
+                channel->receivePacket(data);
             }
-            continue;
-        }
 
-        if (channel->connection() != q) {
-            // If this fails, something is extremely broken. It may be dangerous to continue
-            // processing any data at all. Crash gracefully.
-            TEGO_BUG() << "Channel" << channelId << "found on connection" << this << "but its connection is"
-                  << channel->connection();
-            qFatal("Connection mismatch while handling packet");
-            return;
-        }
-
-        if (data.isEmpty()) {
-            channel->closeChannel();
-        } else {
-            channel->receivePacket(data);
+            // The socket may have been aborted while handling the packet; anything left is unusable
+            if (!socket->isOpen())
+                return;
         }
     }
 }
@@ -423,43 +434,114 @@ bool ConnectionPrivate::writePacket(Channel *channel, const QByteArray &data)
 }
 
 bool ConnectionPrivate::writePacket(int channelId, const QByteArray &data)
+{
+    char *frameData = beginFrame(channelId, data.size());
+    if (!frameData)
+        return false;
+
+    if (!data.isEmpty())
+        std::memcpy(frameData, data.constData(), static_cast<size_t>(data.size()));
+    return true;
+}
+
+char *ConnectionPrivate::beginFrame(int channelId, int dataSize)
 {
     if (channelId < 0 || channelId > UINT16_MAX) {
         TEGO_BUG() << "Cannot write packet for channel with invalid identifier" << channelId;
-        return false;
+        return nullptr;
     }
 
-    if (data.size() > PacketMaxDataSize) {
-        TEGO_BUG() << "Cannot write oversized packet of" << data.size() << "bytes to channel" << channelId;
-        return false;
+    if (dataSize < 0 || dataSize > PacketMaxDataSize) {
+        TEGO_BUG() << "Cannot write oversized packet of" << dataSize << "bytes to channel" << channelId;
+        return nullptr;
     }
 
     if (!q->isConnected()) {
         qDebug() << "Cannot write packet to closed connection";
-        return false;
+        return nullptr;
     }
 
-    Q_STATIC_ASSERT(PacketHeaderSize + PacketMaxDataSize <= UINT16_MAX);
-    Q_STATIC_ASSERT(PacketHeaderSize == 4);
-    uchar header[PacketHeaderSize] = { 0 };
-    qToBigEndian(static_cast<quint16>(PacketHeaderSize + data.size()), header);
-    qToBigEndian(static_cast<quint16>(channelId), &header[2]);
+    Q_STATIC_ASSERT(PacketHeaderSize == SendScheduler::FrameHeaderSize);
+    Q_STATIC_ASSERT(FrameMaxSize == SendScheduler::FrameMaxSize);
+    Q_STATIC_ASSERT(static_cast<int>(Channel::Priority::Bulk) + 1 == SendScheduler::PriorityCount);
+
+    // Replies for channels we don't know about are protocol housekeeping; send them promptly
+    Channel *channel = channels.value(channelId);
+    const auto priority = channel ? channel->priority() : Channel::Priority::Control;
+    char *frameData = sendScheduler.beginFrame(channelId, static_cast<int>(priority), dataSize);
+
+    if (!flushScheduled) {
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() {
+            flushScheduled = false;
+            flushWrites();
+        }, Qt::QueuedConnection);
+    }
 
-    qint64 re = socket->write(reinterpret_cast<char*>(header), PacketHeaderSize);
-    if (re != PacketHeaderSize) {
-        qDebug() << "Connection socket error" << socket->error() << "during write:" << socket->errorString();
-        socket->abort();
-        return false;
+    return frameData;
+}
+
+void ConnectionPrivate::abortFrame(int channelId, int dataSize)
+{
+    if (!sendScheduler.abortFrame(channelId, dataSize))
+        TEGO_BUG() << "Aborting frame of" << PacketHeaderSize + dataSize << "bytes for channel" << channelId << "which doesn't have it queued";
+}
+
+bool ConnectionPrivate::isSendQueueFull()
+{
+    return sendScheduler.isFull(socket ? socket->bytesToWrite() : 0);
+}
+
+void ConnectionPrivate::flushWrites(bool ignoreHighWaterMark)
+{
+    if (sendScheduler.queuedBytes() == 0)
+        return;
+
+    if (!socket || !socket->isOpen()) {
+        sendScheduler.clear();
+        return;
     }
 
-    re = socket->write(data, data.size());
-    if (re != data.size()) {
+    const qint64 budget = ignoreHighWaterMark ? sendScheduler.queuedBytes() : SocketHighWaterMark - socket->bytesToWrite();
+    if (budget <= 0)
+        return;
+
+    // Take the shared buffer for the duration, in case writing to the socket gets back here
+    static const int WriteBufferCapacity = SocketHighWaterMark + FrameMaxSize;
+    QByteArray gathered;
+    gathered.swap(writeBuffer);
+    if (gathered.capacity() < WriteBufferCapacity)
+        gathered.reserve(WriteBufferCapacity);
+
+    sendScheduler.take(budget, gathered);
+
+    const qint64 size = gathered.size();
+    qint64 re = socket->write(gathered.constData(), size);
+
+    // Hand the buffer back for the next flush, unless flushing everything made it grow
+    if (gathered.capacity() <= WriteBufferCapacity) {
+        gathered.resize(0);
+        writeBuffer.swap(gathered);
+    }
+
+    if (re != size) {
         qDebug() << "Connection socket error" << socket->error() << "during write:" << socket->errorString();
         socket->abort();
-        return false;
     }
+}
 
-    return true;
+void ConnectionPrivate::socketBytesWritten()
+{
+    flushWrites();
+
+    if (socket->isOpen() && sendScheduler.takeDrained(socket->bytesToWrite())) {
+        // Channels are only deleted from the event loop, so the copy stays valid while we emit
+        const auto channelsCopy = channels;
+        for (Channel *channel : channelsCopy) {
+            if (channel->priority() == Channel::Priority::Bulk)
+                emit channel->sendQueueDrained();
+        }
+    }
 }
 
 int ConnectionPrivate::availableOutboundChannelId()
@@ -473,7 +555,13 @@ int ConnectionPrivate::availableOutboundChannelId()
         nextOutboundChannelId = minId;
 
     // Find an unused id, trying a maximum of 100 times, using a random step to avoid collision
-    for (int i = 0; i < 100 && channels.contains(nextOutboundChannelId); i++) {
+    // Ids with frames still queued from a closed channel are also skipped; the peer must see that
+    // channel's close before anything is sent on a new one
+    auto inUse = [this](int channelId) {
+        return channels.contains(channelId) || sendScheduler.contains(channelId);
+    };
+
+    for (int i = 0; i < 100 && inUse(nextOutboundChannelId); i++) {
         nextOutboundChannelId += 1 + (QRandomGenerator::global()->bounded(200));
         if (evenNumbered)
             nextOutboundChannelId += nextOutboundChannelId % 2;
@@ -481,7 +569,7 @@ int ConnectionPrivate::availableOutboundChannelId()
             nextOutboundChannelId = minId;
     }
 
-    if (channels.contains(nextOutboundChannelId)) {
+    if (inUse(nextOutboundChannelId)) {
         // Abort the connection if we still couldn't find an id, because it's probably a nasty bug
         TEGO_BUG() << "Can't find an available outbound channel ID for connection; aborting connection";
         socket->abort();
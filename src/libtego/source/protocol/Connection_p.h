@@ -34,6 +34,7 @@
 #define PROTOCOL_CONNECTION_P_H
 
 #include "Connection.h"
+#include "SendScheduler.h"
 
 namespace Protocol
 {
@@ -50,6 +51,20 @@ public:
     static const int PacketMaxDataSize = UINT16_MAX - PacketHeaderSize;
     // Time in seconds before a connection with a purpose of Unknown is killed
     static const int UnknownPurposeTimeout = 15;
+    static const int FrameMaxSize = PacketHeaderSize + PacketMaxDataSize;
+    // Size of the buffer we read socket data into; two maximum size packets, so that a partial
+    // packet at the end never prevents us from reading more. Kept small since every connection
+    // holds one for its lifetime.
+    static const int ReadBufferSize = 2 * FrameMaxSize;
+    // Queued frames are only handed to the socket while it has less than this many bytes
+    // waiting to be sent, so that newly queued high priority packets don't sit behind bulk data
+    static const int SocketHighWaterMark = 2 * FrameMaxSize;
+    // Bulk channels are asked to stop producing packets once this many bytes are waiting in our
+    // queues and the socket, and to resume once it falls below the low water mark
+    static const int SendQueueHighWaterMark = 4 * FrameMaxSize;
+    static const int SendQueueLowWaterMark = SendQueueHighWaterMark / 2;
+    // Bytes of credit each channel receives per deficit round-robin turn; at least one frame
+    static const int SchedulerQuantum = FrameMaxSize;
 
     explicit ConnectionPrivate(Connection *q);
     virtual ~ConnectionPrivate();
@@ -64,6 +79,19 @@ public:
     bool wasClosed;
     bool handshakeDone;
 
+    // Socket data is read into this buffer in large slabs, and packets are handed to channels
+    // as views into it. Bytes in [readBegin, readEnd) have been read but not yet handled.
+    QByteArray readBuffer;
+    int readBegin;
+    int readEnd;
+
+    // Outbound frames are built directly in the queue of their channel. Once control returns to
+    // the event loop, the scheduler takes frames from the queues with the highest priority first,
+    // sharing between channels of the same priority by deficit round-robin, and they are gathered
+    // into one buffer, shared by the connections of a thread, for a single socket write.
+    SendScheduler sendScheduler;
+    bool flushScheduled;
+
     void setSocket(QTcpSocket *socket, Connection::Direction direction);
 
     int availableOutboundChannelId();
@@ -77,12 +105,27 @@ public:
     bool writePacket(Channel *channel, const QByteArray &data);
     bool writePacket(int channelId, const QByteArray &data);
 
+    /* Append a frame for channelId to its send queue with room for dataSize
+     * bytes of packet data, and return a pointer to that space. The caller
+     * must fill it before returning to the event loop. Returns nullptr if the
+     * frame can't be written. */
+    char *beginFrame(int channelId, int dataSize);
+    // Drop the frame just returned by beginFrame, e.g. because filling it failed
+    void abortFrame(int channelId, int dataSize);
+
+    // True if bulk channels should hold off on producing packets until sendQueueDrained
+    bool isSendQueueFull();
+
 public slots:
     void closeImmediately();
+    /* Hand queued frames to the socket in priority order while it is below
+     * SocketHighWaterMark, or all of them if ignoreHighWaterMark is set. */
+    void flushWrites(bool ignoreHighWaterMark = false);
 
 private slots:
     void socketReadable();
     void socketDisconnected();
+    void socketBytesWritten();
 
 private:
     int nextOutboundChannelId;
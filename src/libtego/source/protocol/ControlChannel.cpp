@@ -103,6 +103,12 @@ void ControlChannel::keepAlive()
     sendMessage(packet);
 }
 
+Channel::Priority ControlChannel::priority() const
+{
+    // keepalives and channel setup must not wait behind other channels' data
+    return Priority::Control;
+}
+
 bool ControlChannel::allowInboundChannelRequest(const Data::Control::OpenChannel *request, Data::Control::ChannelResult *result)
 {
     Q_UNUSED(request);
@@ -49,6 +49,7 @@ class ControlChannel : public Channel
 public:
     bool sendOpenChannel(Channel *channel);
     void keepAlive();
+    virtual Priority priority() const;
 
 signals:
     void keepAliveResponse();
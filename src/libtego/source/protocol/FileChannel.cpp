@@ -64,9 +64,9 @@ FileChannel::outgoing_transfer_record::outgoing_transfer_record(
     tego_file_transfer_id_t transferId,
     const std::string& filePath,
     tego_file_size_t fileSize)
-: id(transferId)
-, size(fileSize)
-, offset(0)
+: FileTransferWindow(fileSize)
+, id(transferId)
+, accepted(false)
 , stream(filePath, std::ios::in | std::ios::binary)
 { }
 
@@ -82,6 +82,7 @@ FileChannel::incoming_transfer_record::incoming_transfer_record(
 , size(fileSize)
 , hash(fileHash)
 , stream()
+, hasher()
 { }
 
 FileChannel::incoming_transfer_record::~incoming_transfer_record()
@@ -106,11 +107,10 @@ void FileChannel::incoming_transfer_record::open_stream(const std::string& desti
 {
     this->dest = destination;
 
-    // attempt to open the destination for reading and writing
+    // attempt to open the destination for writing
     // discard previous contents
     // binary mode
-    // we need to read to validate the hash after the transfer completes
-    this->stream.open(this->partial_dest(), std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    this->stream.open(this->partial_dest(), std::ios::out | std::ios::trunc | std::ios::binary);
     TEGO_THROW_IF_FALSE(this->stream.is_open());
 }
 
@@ -122,6 +122,12 @@ FileChannel::FileChannel(Direction direction, Connection *connection)
     : Channel(QStringLiteral("im.ricochet.file-transfer"), direction, connection)
 {
     connect(this->d_ptr->connection, &Connection::closed, this, &FileChannel::onConnectionClosed);
+    connect(this, &Channel::sendQueueDrained, this, &FileChannel::fillTransferWindows);
+}
+
+Channel::Priority FileChannel::priority() const
+{
+    return Priority::Bulk;
 }
 
 bool FileChannel::allowInboundChannelRequest(
@@ -437,8 +443,9 @@ void FileChannel::handleFileHeaderResponse(const Data::File::FileHeaderResponse
 
     if (response == tego_file_transfer_response_accept)
     {
-        sendNextChunk(id);
         it->second.beginTime = std::chrono::system_clock::now();
+        it->second.accepted = true;
+        fillTransferWindow(id);
     }
     else
     {
@@ -483,7 +490,7 @@ void FileChannel::handleFileChunk(const Data::File::FileChunk &message)
 
         // emit progress callback
         const auto id = message.file_id();
-        const auto streamOffset = static_cast<std::streamoff>(itr.stream.tellg());
+        const auto streamOffset = static_cast<std::streamoff>(itr.stream.tellp());
         if (streamOffset == std::streamoff(-1))
         {
             // we should send complete message to sender if we have a disk error so they do not spam us with chunks
@@ -505,6 +512,8 @@ void FileChannel::handleFileChunk(const Data::File::FileChunk &message)
         const auto bytesWritten = static_cast<tego_file_size_t>(streamOffset);
         const auto& bytesTotal = itr.size;
 
+        itr.hasher.update(chunk_data.data(), chunk_data.data() + chunk_data.size());
+
         emit this->fileTransferProgress(id, tego_file_transfer_direction_receiving, bytesWritten, bytesTotal);
 
         auto response = std::make_unique<Data::File::FileChunkAck>();
@@ -517,12 +526,17 @@ void FileChannel::handleFileChunk(const Data::File::FileChunk &message)
 
         if (bytesWritten == bytesTotal)
         {
-            // reset the read/write stream and calculate the file hash
-            itr.stream.seekg(0);
-            tego_file_hash fileHash(itr.stream);
+            // every byte has already passed through our hasher, so no need to read the file back
+            const auto fileHash = itr.hasher.finalize();
+            // flushes any buffered bytes to disk
             itr.stream.close();
 
-            if (fileHash.to_string() != itr.hash)
+            if (itr.stream.fail())
+            {
+                QFile::remove(QString::fromStdString(itr.partial_dest()));
+                emit this->fileTransferFinished(id, tego_file_transfer_direction_receiving, tego_file_transfer_result_filesystem_error);
+            }
+            else if (fileHash.to_string() != itr.hash)
             {
                 // delete file if calculated hash doesn't match expected
                 QFile::remove(QString::fromStdString(itr.partial_dest()));
@@ -582,24 +596,18 @@ void FileChannel::handleFileChunkAck(const Data::File::FileChunkAck &message)
         return;
     }
 
-    const auto& otr = it->second;
+    auto& otr = it->second;
 
-    // verify the ack corresponds to how many bytes we've sent
-    if (message.bytes_received() != otr.offset)
+    if (!otr.acknowledge(message.bytes_received()))
     {
-        // acks currently always come between sending chunks, so our bytes sent and their bytes received should
-        // not diverge
         emitFatalError("mismatch between bytes we have sent and the bytes the receiver claims to have received", tego_file_transfer_result_failure, true);
         return;
     }
 
-    emit this->fileTransferProgress(otr.id, tego_file_transfer_direction_receiving, otr.offset, otr.size);
+    emit this->fileTransferProgress(otr.id, tego_file_transfer_direction_receiving, otr.acked, otr.size);
 
-    // send the next chunk until we are done
-    if(otr.offset < otr.size)
-    {
-        sendNextChunk(id);
-    }
+    // top up the window until we are done
+    fillTransferWindow(id);
 }
 
 // statically verify that our tego_file_transfer_result_t enum matches the FileTransferResult enum
@@ -818,9 +826,9 @@ void FileChannel::sendNextChunk(tego_file_transfer_id_t id)
         // read the next chunk to our buffer, and update our offset
         otr.stream.read(this->chunkBuffer, FileMaxChunkSize);
         const auto chunkSize = otr.stream.gcount();
-        // ensure we read a valid value
+        // ensure we read a valid value, an empty read means the file shrank underneath us
         static_assert(FileMaxChunkSize != std::numeric_limits<std::streamsize>::max());
-        if (chunkSize == std::numeric_limits<std::streamsize>::max())
+        if (chunkSize <= 0 || chunkSize == std::numeric_limits<std::streamsize>::max())
         {
             // not quite a fatal error, but we need to cleanup this transfer
             emitNonFatalError("Problem reading the next chunk from disk", id, tego_file_transfer_result_filesystem_error);
@@ -838,7 +846,7 @@ void FileChannel::sendNextChunk(tego_file_transfer_id_t id)
         }
         Q_ASSERT(static_cast<tego_file_size_t>(chunkSize) <= FileMaxChunkSize);
 
-        otr.offset += static_cast<unsigned long>(chunkSize);
+        otr.sent(static_cast<tego_file_size_t>(chunkSize));
 
         // build our chunk
         auto chunk = std::make_unique<Data::File::FileChunk>();
@@ -852,3 +860,54 @@ void FileChannel::sendNextChunk(tego_file_transfer_id_t id)
         Channel::sendMessage(packet);
     }
 }
+
+void FileChannel::fillTransferWindow(tego_file_transfer_id_t id)
+{
+    Q_ASSERT(direction() == Outbound);
+
+    const auto windowSize = g_globals.context->get_file_transfer_window_size();
+
+    // sendNextChunk() erases the record if reading from disk fails, so look it up each time
+    for (auto it = outgoingTransfers.find(id);
+         it != outgoingTransfers.end() && it->second.canSend(windowSize) && !isSendQueueFull();
+         it = outgoingTransfers.find(id))
+    {
+        sendNextChunk(id);
+    }
+}
+
+void FileChannel::fillTransferWindows()
+{
+    if (direction() != Outbound)
+    {
+        return;
+    }
+
+    const auto windowSize = g_globals.context->get_file_transfer_window_size();
+
+    std::vector<tego_file_transfer_id_t> ids;
+    for (bool sentChunk = true; sentChunk && !isSendQueueFull();)
+    {
+        sentChunk = false;
+
+        ids.clear();
+        for (const auto& [id, otr] : outgoingTransfers)
+        {
+            if (otr.accepted && otr.canSend(windowSize))
+            {
+                ids.push_back(id);
+            }
+        }
+
+        for (auto id : ids)
+        {
+            if (isSendQueueFull())
+            {
+                break;
+            }
+            // sendNextChunk() looks the transfer up itself and only ever erases that one
+            sendNextChunk(id);
+            sentChunk = true;
+        }
+    }
+}
@@ -37,6 +37,7 @@
 #include "FileChannel.pb.h"
 #include "tego/tego.h"
 #include "file_hash.hpp"
+#include "FileTransferWindow.h"
 
 namespace Protocol
 {
@@ -53,6 +54,15 @@ public:
     void acceptFile(tego_file_transfer_id_t id, const std::string& dest);
     void rejectFile(tego_file_transfer_id_t id);
     bool cancelTransfer(tego_file_transfer_id_t id);
+
+    // file data must not hold up chat messages on the same connection
+    virtual Priority priority() const;
+
+    // 63 kb, max packet size is UINT16_MAX (ak 65535, 64k - 1) so leave space for other data
+    constexpr static tego_file_size_t FileMaxChunkSize = 63*1024; // bytes
+    // default number of unacknowledged bytes we allow on the wire per outgoing transfer; with
+    // Tor round trips of a second or more, a single chunk in flight caps throughput at ~63 kb/s
+    constexpr static tego_file_size_t FileDefaultWindowSize = 16 * FileMaxChunkSize; // bytes
     // signals bubble up to the ConversationModel object that owns this FileChannel
 signals:
     void fileTransferRequestReceived(tego_file_transfer_id_t id, QString fileName, tego_file_size_t fileSize, tego_file_hash_t);
@@ -78,7 +88,7 @@ private:
     // verify that std::streamoff is representable as qint64 (type used by Qt File APIs for sizes)
     static_assert(std::numeric_limits<std::streamoff>::max() <= std::numeric_limits<qint64>::max());
 
-    struct outgoing_transfer_record
+    struct outgoing_transfer_record : FileTransferWindow
     {
         outgoing_transfer_record(
             tego_file_transfer_id_t id,
@@ -88,11 +98,9 @@ private:
         std::chrono::time_point<std::chrono::system_clock> beginTime;
 
         const tego_file_transfer_id_t id;
-        const tego_file_size_t size;
-        tego_file_size_t offset;
+        // whether the receiver has accepted the transfer, we only send chunks after that
+        bool accepted;
         std::ifstream stream;
-
-        inline bool finished() const { return offset == size; }
     };
 
     struct incoming_transfer_record
@@ -114,14 +122,13 @@ private:
         std::string dest; // destination to save to
         const std::string hash;
 
-        // need to write and read
-        std::fstream stream;
+        std::ofstream stream;
+        // hashes each chunk as it is written so we can verify the file without reading it back
+        tego_file_hasher hasher;
 
         std::string partial_dest() const;
         void open_stream(const std::string& dest);
     };
-    // 63 kb, max packet size is UINT16_MAX (ak 65535, 64k - 1) so leave space for other data
-    constexpr static tego_file_size_t FileMaxChunkSize = 63*1024; // bytes
     // intermediate buffer we load chunks from disk into
     // each access to this buffer happens on the same thread, and only within the scope of a function
     // so no need to worry about synchronization or sharing between file transfers
@@ -154,6 +161,11 @@ private:
     void handleFileTransferCompleteNotification(const Data::File::FileTransferCompleteNotification &message);
 
     void sendNextChunk(tego_file_transfer_id_t id);
+    // send chunks until the transfer's in-flight bytes reach the window size, or the
+    // connection's send queue is full
+    void fillTransferWindow(tego_file_transfer_id_t id);
+    // fill the windows of all accepted transfers a chunk at a time, so they share the connection
+    void fillTransferWindows();
 };
 
 }
@@ -0,0 +1,49 @@
+#ifndef PROTOCOL_FILETRANSFERWINDOW_H
+#define PROTOCOL_FILETRANSFERWINDOW_H
+
+#include "tego/tego.h"
+
+namespace Protocol
+{
+
+/* Tracks how far an outgoing file transfer has got. Chunks are sent ahead
+ * of the receiver's acks, up to a window of unacknowledged bytes; each ack
+ * reports the total bytes the receiver has written so far. */
+struct FileTransferWindow
+{
+    explicit FileTransferWindow(tego_file_size_t fileSize)
+    : size(fileSize)
+    , offset(0)
+    , acked(0)
+    { }
+
+    const tego_file_size_t size;
+    // bytes read from disk and sent to the receiver
+    tego_file_size_t offset;
+    // bytes the receiver has acknowledged writing
+    tego_file_size_t acked;
+
+    inline bool finished() const { return offset == size; }
+    inline tego_file_size_t inFlight() const { return offset - acked; }
+    // whether another chunk may be sent without going past windowSize unacknowledged bytes
+    inline bool canSend(tego_file_size_t windowSize) const { return !finished() && inFlight() < windowSize; }
+
+    inline void sent(tego_file_size_t bytes) { offset += bytes; }
+
+    /* Advance the window to bytesReceived. Acks are cumulative and arrive in
+     * the order we sent our chunks, so each must move the window forward
+     * without going past the bytes we have sent; returns false otherwise. */
+    inline bool acknowledge(tego_file_size_t bytesReceived)
+    {
+        if (bytesReceived <= acked || bytesReceived > offset)
+        {
+            return false;
+        }
+        acked = bytesReceived;
+        return true;
+    }
+};
+
+}
+
+#endif
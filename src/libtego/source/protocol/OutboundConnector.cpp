@@ -33,6 +33,7 @@
 #include "OutboundConnector.h"
 #include "utils/Useful.h"
 #include "tor/TorSocket.h"
+#include "tor/TorSocketScheduler.h"
 #include "ControlChannel.h"
 #include "AuthHiddenServiceChannel.h"
 
@@ -56,6 +57,9 @@ public:
     QString errorMessage;
     QTimer errorRetryTimer;
     int errorRetryCount;
+    // seconds
+    int errorRetryInterval;
+    qint64 priority;
 
     OutboundConnectorPrivate(OutboundConnector *oc)
         : QObject(oc)
@@ -64,6 +68,8 @@ public:
         , port(0)
         , status(OutboundConnector::Inactive)
         , errorRetryCount(0)
+        , errorRetryInterval(0)
+        , priority(0)
     {
         connect(&errorRetryTimer, &QTimer::timeout, this, &OutboundConnectorPrivate::retryAfterError);
     }
@@ -130,18 +136,27 @@ bool OutboundConnector::connectToHost(const QString &hostname, quint16 port)
     d->port = port;
 
     d->socket = new Tor::TorSocket(this);
+    d->socket->setPriority(d->priority);
     connect(d->socket, &Tor::TorSocket::connected, d, &OutboundConnectorPrivate::onConnected);
     d->setStatus(Connecting);
     d->socket->connectToHost(d->hostname, d->port);
     return true;
 }
 
+void OutboundConnector::setPriority(qint64 priority)
+{
+    d->priority = priority;
+    if (d->socket)
+        d->socket->setPriority(priority);
+}
+
 void OutboundConnector::abort()
 {
     d->abort();
     d->hostname.clear();
     d->port = 0;
     d->errorRetryCount = 0;
+    d->errorRetryInterval = 0;
     d->errorRetryTimer.stop();
     d->errorMessage.clear();
     d->setStatus(Inactive);
@@ -198,6 +213,10 @@ void OutboundConnectorPrivate::setStatus(OutboundConnector::Status value)
 
     bool wasActive = q->isActive();
     status = value;
+    if (status == OutboundConnector::Ready) {
+        errorRetryCount = 0;
+        errorRetryInterval = 0;
+    }
     emit q->statusChanged();
     if (wasActive != q->isActive())
         emit q->isActiveChanged();
@@ -216,9 +235,11 @@ void OutboundConnectorPrivate::setError(const QString &message)
         return;
     }
 
+    // jittered, so contacts that failed together don't all retry together
+    errorRetryInterval = Tor::TorSocketScheduler::nextBackoff(errorRetryInterval, 60, 600);
     errorRetryTimer.setSingleShot(true);
-    errorRetryTimer.start(60 * 1000);
-    qDebug() << "Retrying outbound connection attempt in 60 seconds after an error";
+    errorRetryTimer.start(errorRetryInterval * 1000);
+    qDebug() << "Retrying outbound connection attempt in" << errorRetryInterval << "seconds after an error";
 }
 
 void OutboundConnectorPrivate::retryAfterError()
@@ -234,7 +255,14 @@ void OutboundConnectorPrivate::retryAfterError()
         return;
     }
 
-    q->connectToHost(hostname, port);
+    // connectToHost() starts by aborting, which clears these; keep copies,
+    // and keep counting errors across the retry
+    const QString retryHostname = hostname;
+    const int retryCount = errorRetryCount;
+    const int retryInterval = errorRetryInterval;
+    q->connectToHost(retryHostname, port);
+    errorRetryCount = retryCount;
+    errorRetryInterval = retryInterval;
 }
 
 void OutboundConnectorPrivate::onConnected()
@@ -71,6 +71,8 @@ public:
 
     bool connectToHost(const QString &hostname, quint16 port);
     void setAuthPrivateKey(const CryptoKey &key);
+    /* Order among connections waiting for their turn, higher first; see TorSocket */
+    void setPriority(qint64 priority);
 
     /* Take ownership of the Connection object when Ready
      *
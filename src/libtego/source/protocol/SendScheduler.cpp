@@ -0,0 +1,125 @@
+#include "SendScheduler.h"
+
+#include <QtEndian>
+
+using namespace Protocol;
+
+SendScheduler::SendScheduler(int quantum, qint64 highWaterMark, qint64 lowWaterMark)
+    : m_queuedBytes(0)
+    , m_quantum(quantum)
+    , m_highWaterMark(highWaterMark)
+    , m_lowWaterMark(lowWaterMark)
+    , m_full(false)
+{
+    Q_ASSERT(quantum > 0);
+    Q_ASSERT(lowWaterMark <= highWaterMark);
+}
+
+char *SendScheduler::beginFrame(int channelId, int priority, int dataSize)
+{
+    Q_ASSERT(channelId >= 0 && channelId <= UINT16_MAX);
+    Q_ASSERT(priority >= 0 && priority < PriorityCount);
+    Q_ASSERT(dataSize >= 0 && dataSize <= FrameMaxSize - FrameHeaderSize);
+
+    const int frameSize = FrameHeaderSize + dataSize;
+
+    Queue &queue = m_queues[channelId];
+    if (queue.pending() == 0)
+        m_active[priority].append(channelId);
+
+    // Reclaim space taken by frames that have already been taken
+    if (queue.head >= FrameMaxSize) {
+        queue.frames.remove(0, queue.head);
+        queue.head = 0;
+    }
+
+    const int frameBegin = queue.frames.size();
+    queue.frames.resize(frameBegin + frameSize);
+    m_queuedBytes += frameSize;
+
+    uchar *header = reinterpret_cast<uchar*>(queue.frames.data() + frameBegin);
+    qToBigEndian(static_cast<quint16>(frameSize), header);
+    qToBigEndian(static_cast<quint16>(channelId), &header[2]);
+
+    return reinterpret_cast<char*>(header + FrameHeaderSize);
+}
+
+bool SendScheduler::abortFrame(int channelId, int dataSize)
+{
+    const int frameSize = FrameHeaderSize + dataSize;
+    auto it = m_queues.find(channelId);
+    if (it == m_queues.end() || frameSize > it->pending())
+        return false;
+
+    it->frames.resize(it->frames.size() - frameSize);
+    m_queuedBytes -= frameSize;
+
+    if (it->pending() == 0) {
+        m_queues.erase(it);
+        for (QList<int> &active : m_active)
+            active.removeOne(channelId);
+    }
+    return true;
+}
+
+qint64 SendScheduler::take(qint64 budget, QByteArray &out)
+{
+    qint64 taken = 0;
+
+    for (QList<int> &active : m_active) {
+        while (!active.isEmpty() && taken < budget) {
+            const int channelId = active.takeFirst();
+            auto it = m_queues.find(channelId);
+            if (it == m_queues.end())
+                continue;
+
+            Queue &queue = *it;
+            queue.deficit += m_quantum;
+            while (queue.pending() > 0 && taken < budget) {
+                const uchar *header = reinterpret_cast<const uchar*>(queue.frames.constData() + queue.head);
+                const int frameSize = qFromBigEndian<quint16>(header);
+                if (frameSize > queue.deficit)
+                    break;
+
+                out.append(queue.frames.constData() + queue.head, frameSize);
+                queue.head += frameSize;
+                queue.deficit -= frameSize;
+                taken += frameSize;
+            }
+
+            if (queue.pending() > 0) {
+                active.append(channelId);
+            } else {
+                // Idle channels don't bank credit
+                m_queues.erase(it);
+            }
+        }
+    }
+
+    m_queuedBytes -= taken;
+    return taken;
+}
+
+void SendScheduler::clear()
+{
+    m_queues.clear();
+    for (QList<int> &active : m_active)
+        active.clear();
+    m_queuedBytes = 0;
+    m_full = false;
+}
+
+bool SendScheduler::isFull(qint64 unsentBytes)
+{
+    if (m_queuedBytes + unsentBytes >= m_highWaterMark)
+        m_full = true;
+    return m_queuedBytes + unsentBytes >= m_highWaterMark;
+}
+
+bool SendScheduler::takeDrained(qint64 unsentBytes)
+{
+    if (!m_full || m_queuedBytes + unsentBytes >= m_lowWaterMark)
+        return false;
+    m_full = false;
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef PROTOCOL_SENDSCHEDULER_H
+#define PROTOCOL_SENDSCHEDULER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <cstdint>
+
+namespace Protocol
+{
+
+/* Queues outbound frames per channel and decides the order they go out in.
+ *
+ * Frames are built in place in the queue of their channel. take() gathers
+ * them with strict priority between classes, lowest class first, sharing
+ * between the channels of a class by deficit round-robin. The water marks
+ * give bulk producers hysteresis: they are told to stop once the backlog
+ * reaches the high mark, and to resume only once it falls below the low one.
+ */
+class SendScheduler
+{
+    Q_DISABLE_COPY(SendScheduler)
+
+public:
+    // Frames are a big endian 16 bit size, including the header, then a 16 bit channel id
+    static constexpr int FrameHeaderSize = 4;
+    static constexpr int FrameMaxSize = UINT16_MAX;
+    // Number of priority classes; matches Channel::Priority
+    static constexpr int PriorityCount = 3;
+
+    /* quantum is the credit in bytes each channel receives per round-robin
+     * turn; with at least one frame's worth, every turn sends something. */
+    SendScheduler(int quantum, qint64 highWaterMark, qint64 lowWaterMark);
+
+    /* Append a frame for channelId to its queue with room for dataSize bytes
+     * of packet data, and return a pointer to that space. A channel keeps
+     * the priority it had when its queue was last empty. */
+    char *beginFrame(int channelId, int priority, int dataSize);
+    // Drop the frame just returned by beginFrame; false if there is no such frame
+    bool abortFrame(int channelId, int dataSize);
+
+    /* Append whole frames to out in scheduling order until at least budget
+     * bytes were taken or the queues are empty, and return the bytes taken. */
+    qint64 take(qint64 budget, QByteArray &out);
+    void clear();
+
+    // Total bytes queued over all channels
+    qint64 queuedBytes() const { return m_queuedBytes; }
+    // True while channelId has frames waiting
+    bool contains(int channelId) const { return m_queues.contains(channelId); }
+
+    /* True if bulk producers should hold off, given unsentBytes already
+     * handed on but not yet sent (e.g. in the socket) */
+    bool isFull(qint64 unsentBytes);
+    /* True once after isFull has returned true and the backlog has since
+     * fallen below the low water mark */
+    bool takeDrained(qint64 unsentBytes);
+
+private:
+    struct Queue
+    {
+        // complete frames, in the order they were written
+        QByteArray frames;
+        // offset of the first frame in 'frames' that hasn't been taken
+        int head = 0;
+        // deficit round-robin credit, in bytes
+        int deficit = 0;
+
+        int pending() const { return frames.size() - head; }
+    };
+
+    QHash<int,Queue> m_queues;
+    // channel ids with a non-empty queue, in round-robin order, by priority
+    QList<int> m_active[PriorityCount];
+    qint64 m_queuedBytes;
+    const int m_quantum;
+    const qint64 m_highWaterMark;
+    const qint64 m_lowWaterMark;
+    // whether isFull has told a producer to stop
+    bool m_full;
+};
+
+}
+
+#endif
@@ -49,7 +49,8 @@ namespace tego
     callback_queue::callback_queue(tego_context* context)
     : context_(context)
     , terminating_(false)
-    , mutex_()
+    , mutex_("callback_queue")
+    , wakeup_()
     , pending_callbacks_()
     , worker_([](tego_context* ctx) -> void
     {
@@ -60,21 +61,26 @@ namespace tego
         // enqueued tasks
         decltype(self.pending_callbacks_) local_queue;
 
-        // we keep spinning until termination is signaled
+        // we keep working until termination is signaled
         while(!self.terminating_)
         {
-            // acquire the queue's lock and swap our queues
+            // acquire the queue's lock, wait for work and swap our queues
             // the backend can now keep emitting callbacks
             // while we work through our queue of old ones
             {
-                std::lock_guard<std::mutex> lock(self.mutex_);
+                std::unique_lock<instrumented_mutex> lock(self.mutex_);
+                self.wakeup_.wait(lock, [&self]() -> bool
+                {
+                    return self.terminating_ || !self.pending_callbacks_.empty();
+                });
+                if (self.terminating_)
+                {
+                    break;
+                }
                 std::swap(local_queue, self.pending_callbacks_);
             }
 
             for(auto& callback : local_queue) {
-                // acquire our context's lock so that we don't have two
-                // threads potentially modifying internals
-                std::lock_guard<std::mutex> lock(ctx->mutex_);
                 try
                 {
                     callback.invoke();
@@ -84,9 +90,6 @@ namespace tego
             }
             // empty our our local queue
             local_queue.clear();
-
-            // sleep before looking for more work
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
 
     }, context)
@@ -96,8 +99,14 @@ namespace tego
 
     callback_queue::~callback_queue()
     {
-        // signal our worker thread to finish up and terminate
-        terminating_ = true;
+        // signal our worker thread to finish up and terminate; the flag is set
+        // under the lock so the worker can't miss the wakeup between checking
+        // its wait condition and going to sleep
+        {
+            std::lock_guard<instrumented_mutex> lock(mutex_);
+            terminating_ = true;
+        }
+        wakeup_.notify_one();
         worker_.join();
     }
 
@@ -106,8 +115,18 @@ namespace tego
         // acquire our lock and push into our vec
         if (!terminating_)
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            pending_callbacks_.push_back(std::move(callback));
+            bool wasEmpty = false;
+            {
+                std::lock_guard<instrumented_mutex> lock(mutex_);
+                wasEmpty = pending_callbacks_.empty();
+                pending_callbacks_.push_back(std::move(callback));
+            }
+            // the worker only sleeps with an empty queue, so only wake it for
+            // the first callback of a burst
+            if (wasEmpty)
+            {
+                wakeup_.notify_one();
+            }
         }
     }
 }
@@ -145,6 +164,7 @@ extern "C"
     TEGO_DEFINE_CALLBACK_SETTER(message_received)
     TEGO_DEFINE_CALLBACK_SETTER(message_acknowledged)
     TEGO_DEFINE_CALLBACK_SETTER(file_transfer_request_received)
+    TEGO_DEFINE_CALLBACK_SETTER(file_transfer_hashed)
     TEGO_DEFINE_CALLBACK_SETTER(file_transfer_request_acknowledged)
     TEGO_DEFINE_CALLBACK_SETTER(file_transfer_request_response_received)
     TEGO_DEFINE_CALLBACK_SETTER(file_transfer_progress)
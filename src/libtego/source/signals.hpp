@@ -1,5 +1,7 @@
 #pragma once
 
+#include "lock_stats.hpp"
+
 namespace tego
 {
     // allows us to marshall lambda functions and their data to
@@ -91,6 +93,7 @@ namespace tego
         TEGO_IMPLEMENT_CALLBACK_FUNCTIONS(message_received, tego_user_id_t*, tego_time_t, tego_message_id_t, char*, size_t)
         TEGO_IMPLEMENT_CALLBACK_FUNCTIONS(message_acknowledged, tego_user_id_t*, tego_message_id_t, tego_bool_t)
         TEGO_IMPLEMENT_CALLBACK_FUNCTIONS(file_transfer_request_received, tego_user_id_t*, tego_file_transfer_id_t, char*, size_t, uint64_t, tego_file_hash_t*)
+        TEGO_IMPLEMENT_CALLBACK_FUNCTIONS(file_transfer_hashed, tego_user_id_t*, tego_file_transfer_id_t, tego_file_hash_t*)
         TEGO_IMPLEMENT_CALLBACK_FUNCTIONS(file_transfer_request_acknowledged, tego_user_id_t*, tego_file_transfer_id_t, tego_bool_t)
         TEGO_IMPLEMENT_CALLBACK_FUNCTIONS(file_transfer_request_response_received, tego_user_id_t*, tego_file_transfer_id_t, tego_file_transfer_response_t)
         TEGO_IMPLEMENT_CALLBACK_FUNCTIONS(file_transfer_progress, tego_user_id_t*, tego_file_transfer_id_t, tego_file_transfer_direction_t, uint64_t, uint64_t)
@@ -137,6 +140,10 @@ namespace tego
      * callback_queue holds onto a queue of callbacks. Libtego internals
      * enqueue callbacks and the callback queue executes them on a
      * background worker thread
+     *
+     * Callbacks are invoked without holding any lock: each one owns copies
+     * of its arguments, so a slow user callback only delays the callbacks
+     * queued behind it and never the backend.
      */
     class callback_queue
     {
@@ -145,11 +152,18 @@ namespace tego
         ~callback_queue();
 
         void push_back(type_erased_callback&&);
+
+        // contention between the backend enqueueing and the worker draining,
+        // reported by tego_context_get_lock_stats
+        tego::lock_stats lock_stats() const { return mutex_.stats(); }
     private:
         tego_context* context_;
 
         std::atomic_bool terminating_;
-        std::mutex mutex_;
+        instrumented_mutex mutex_;
+        // signaled when callbacks are enqueued or we are terminating, the
+        // worker_ thread sleeps on this while there is no work
+        std::condition_variable_any wakeup_;
         // this queue is protected by mutex_ within worker_ thread and callback_queue methods
         std::vector<type_erased_callback> pending_callbacks_;
 
@@ -33,6 +33,7 @@
 #include "utils/PendingOperation.h"
 #include "TorControl.h"
 #include "TorControlSocket.h"
+#include "TorSocketScheduler.h"
 #include "HiddenService.h"
 #include "AuthenticateCommand.h"
 #include "SetConfCommand.h"
@@ -59,6 +60,7 @@ public:
     TorControl *q;
 
     TorControlSocket *socket;
+    TorSocketScheduler *socketScheduler;
     QHostAddress torAddress;
     QString errorMessage;
     QString torVersion;
@@ -105,6 +107,7 @@ TorControlPrivate::TorControlPrivate(TorControl *parent)
       hasOwnership(false)
 {
     socket = new TorControlSocket(this);
+    socketScheduler = new TorSocketScheduler(TorSocketScheduler::DefaultMaxActive, this);
     QObject::connect(socket, SIGNAL(connected()), this, SLOT(socketConnected()));
     QObject::connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
     QObject::connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(socketError()));
@@ -237,6 +240,11 @@ HiddenService const* TorControl::getHiddenService() const
     return d->service;
 }
 
+TorSocketScheduler *TorControl::socketScheduler() const
+{
+    return d->socketScheduler;
+}
+
 QVariantMap TorControl::bootstrapStatus() const
 {
     return d->bootstrapStatus;
@@ -294,14 +302,34 @@ void TorControlPrivate::authenticateReply()
     qDebug() << "torctrl: Authentication successful";
 
     setTorStatus(TorControl::TorUnknown);
+}
+
+void TorControlPrivate::socketConnected()
+{
+    Q_ASSERT(status == TorControl::Connecting);
+
+    qDebug() << "torctrl: Connected socket; querying information";
+    setStatus(TorControl::Authenticating);
+
+    AuthenticateCommand *authenticate = new AuthenticateCommand;
+    connect(authenticate, &TorControlCommand::finished, this, &TorControlPrivate::authenticateReply);
+    socket->sendCommand(authenticate, authenticate->build(authPassword));
+
+    /* The rest of the setup is pipelined behind AUTHENTICATE rather than
+     * waiting for its reply. Tor answers in order, so these are only seen
+     * once authentication has succeeded; if it fails tor closes the
+     * connection and they are dropped with it. */
 
     // register for events
     TorControlCommand *clientEvents = new TorControlCommand;
     connect(clientEvents, &TorControlCommand::replyLine, this, &TorControlPrivate::statusEvent);
-    socket->registerEvent("STATUS_CLIENT", clientEvents);
     TorControlCommand *hsDescEvents = new TorControlCommand;
     connect(hsDescEvents, &TorControlCommand::replyLine, this, &TorControlPrivate::hsDescEvent);
-    socket->registerEvent("HS_DESC", hsDescEvents);
+
+    QHash<QByteArray,TorControlCommand*> events;
+    events.insert("STATUS_CLIENT", clientEvents);
+    events.insert("HS_DESC", hsDescEvents);
+    socket->registerEvents(events);
 
     // get info
     GetConfCommand *getConfCommand = new GetConfCommand(GetConfCommand::GetInfo);
@@ -315,18 +343,6 @@ void TorControlPrivate::authenticateReply()
     socket->sendCommand(getConfCommand, getConfCommand->build(keys));
 }
 
-void TorControlPrivate::socketConnected()
-{
-    Q_ASSERT(status == TorControl::Connecting);
-
-    qDebug() << "torctrl: Connected socket; querying information";
-    setStatus(TorControl::Authenticating);
-
-    AuthenticateCommand *authenticate = new AuthenticateCommand;
-    connect(authenticate, &TorControlCommand::finished, this, &TorControlPrivate::authenticateReply);
-    socket->sendCommand(authenticate, authenticate->build(authPassword));
-}
-
 void TorControlPrivate::socketDisconnected()
 {
     /* Clear some internal state */
@@ -42,6 +42,7 @@ namespace Tor
 
 class HiddenService;
 class TorControlPrivate;
+class TorSocketScheduler;
 
 class TorControl : public QObject
 {
@@ -96,6 +97,9 @@ public:
     void setHiddenService(HiddenService* service);
     void publishHiddenService();
 
+    /* Paces the connection attempts of every TorSocket */
+    TorSocketScheduler *socketScheduler() const;
+
     QVariantMap bootstrapStatus() const;
     QObject *getConfiguration(const QString &options);
     QObject *setConfiguration(const QVariantMap &options);
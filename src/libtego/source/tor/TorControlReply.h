@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QByteArray>
+#include <string_view>
+
+namespace Tor
+{
+
+/* One line of a control port reply, split into its parts without copying;
+ * data points into the buffer the line was read from. */
+struct TorControlReplyLine
+{
+    int statusCode = 0;
+    // ' ' for the final line of a reply, '-' for a mid reply line, '+' when a data block follows
+    char type = 0;
+    std::string_view data;
+
+    bool isFinal() const { return type == ' '; }
+    bool startsData() const { return type == '+'; }
+    // 6xx replies are asynchronous events, not replies to a command
+    bool isEvent() const { return statusCode >= 600 && statusCode < 700; }
+
+    // the keyword an event line starts with, e.g. STATUS_CLIENT
+    std::string_view eventName() const
+    {
+        return data.substr(0, data.find(' '));
+    }
+
+    // parse a line without its CRLF; returns false if it is not a valid reply line
+    static bool parse(std::string_view line, TorControlReplyLine &reply)
+    {
+        if (line.size() < 4)
+            return false;
+
+        int code = 0;
+        for (int i = 0; i < 3; ++i) {
+            const char c = line[i];
+            if (c < '0' || c > '9')
+                return false;
+            code = code * 10 + (c - '0');
+        }
+
+        const char type = line[3];
+        if (type != ' ' && type != '-' && type != '+')
+            return false;
+
+        reply.statusCode = code;
+        reply.type = type;
+        reply.data = line.substr(4);
+        return true;
+    }
+};
+
+/* Splits the bytes read from the control port into CRLF terminated lines.
+ * Lines are handed out as views into the buffer, which stay valid until the
+ * next call to append() or clear(). */
+class TorControlLineBuffer
+{
+public:
+    // longest line accepted, not counting the CRLF
+    static constexpr int MaxLineLength = 64 * 1024;
+
+    enum class Result { Line, NeedMore, Invalid };
+
+    void append(const QByteArray &bytes)
+    {
+        // drop what was already consumed before the buffer grows
+        if (m_pos > 0) {
+            m_buffer.remove(0, m_pos);
+            m_pos = 0;
+        }
+        m_buffer.append(bytes);
+    }
+
+    Result next(std::string_view &line)
+    {
+        const std::string_view pending(m_buffer.constData() + m_pos, static_cast<size_t>(m_buffer.size() - m_pos));
+
+        const size_t lf = pending.find('\n');
+        if (lf == std::string_view::npos)
+            return pending.size() > static_cast<size_t>(MaxLineLength) + 1 ? Result::Invalid : Result::NeedMore;
+        if (lf == 0 || pending[lf - 1] != '\r' || lf - 1 > static_cast<size_t>(MaxLineLength))
+            return Result::Invalid;
+
+        line = pending.substr(0, lf - 1);
+        m_pos += static_cast<qsizetype>(lf + 1);
+        return Result::Line;
+    }
+
+    void clear()
+    {
+        m_buffer.clear();
+        m_pos = 0;
+    }
+
+private:
+    QByteArray m_buffer;
+    qsizetype m_pos = 0;
+};
+
+}
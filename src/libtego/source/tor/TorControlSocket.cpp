@@ -35,6 +35,14 @@
 
 using namespace Tor;
 
+namespace {
+    // the only copy made of a reply line, for handlers that keep it
+    QByteArray toByteArray(std::string_view data)
+    {
+        return QByteArray(data.data(), static_cast<int>(data.size()));
+    }
+}
+
 TorControlSocket::TorControlSocket(QObject *parent)
     : QTcpSocket(parent), currentCommand(0), inDataReply(false)
 {
@@ -57,9 +65,10 @@ void TorControlSocket::sendCommand(TorControlCommand *command, const QByteArray
     qDebug() << "torctrl: Sent" << data.trimmed();
 }
 
-void TorControlSocket::registerEvent(const QByteArray &event, TorControlCommand *command)
+void TorControlSocket::registerEvents(const QHash<QByteArray,TorControlCommand*> &handlers)
 {
-    eventCommands.insert(event, command);
+    for (auto it = handlers.begin(); it != handlers.end(); ++it)
+        eventCommands.insert(it.key(), it.value());
 
     QByteArray data("SETEVENTS");
     foreach (const QByteArray &key, eventCommands.keys()) {
@@ -77,6 +86,7 @@ void TorControlSocket::clear()
     commandQueue.clear();
     qDeleteAll(eventCommands);
     eventCommands.clear();
+    readBuffer.clear();
     inDataReply = false;
     currentCommand = 0;
 }
@@ -90,88 +100,88 @@ void TorControlSocket::setError(const QString &message)
 
 void TorControlSocket::process()
 {
+    readBuffer.append(readAll());
+
+    std::string_view line;
     for (;;) {
-        if (!canReadLine())
+        switch (readBuffer.next(line)) {
+        case TorControlLineBuffer::Result::NeedMore:
             return;
-
-        QByteArray line = readLine(5120);
-        qDebug() << "torctrl: Recv" << line.trimmed();
-
-        if (!line.endsWith("\r\n")) {
+        case TorControlLineBuffer::Result::Invalid:
             setError(QStringLiteral("Invalid control message syntax"));
             return;
-        }
-        line.chop(2);
-
-        if (inDataReply) {
-            if (line == ".") {
-                inDataReply = false;
-                if (currentCommand)
-                    currentCommand->onDataFinished();
-                currentCommand = 0;
-            } else {
-                if (currentCommand)
-                    currentCommand->onDataLine(line);
-            }
-            continue;
+        case TorControlLineBuffer::Result::Line:
+            processLine(line);
+            break;
         }
 
-        if (line.size() < 4) {
-            setError(QStringLiteral("Invalid control message syntax"));
+        // a handler may have dropped the connection, and with it the buffer
+        if (!isOpen())
             return;
-        }
+    }
+}
 
-        int statusCode = line.left(3).toInt();
-        char type = line[3];
-        bool isFinalReply = (type == ' ');
-        inDataReply = (type == '+');
+void TorControlSocket::processLine(std::string_view line)
+{
+    if (inDataReply) {
+        if (line == ".") {
+            inDataReply = false;
+            if (currentCommand)
+                currentCommand->onDataFinished();
+            currentCommand = 0;
+        } else if (currentCommand) {
+            // data lines starting with a '.' have it doubled
+            if (line.size() > 1 && line[0] == '.')
+                line.remove_prefix(1);
+            currentCommand->onDataLine(toByteArray(line));
+        }
+        return;
+    }
 
-        // Trim down to just data
-        line = line.mid(4);
+    TorControlReplyLine reply;
+    if (!TorControlReplyLine::parse(line, reply)) {
+        setError(QStringLiteral("Invalid control message syntax"));
+        return;
+    }
+    inDataReply = reply.startsData();
 
-        if (!isFinalReply && !inDataReply && type != '-') {
-            setError(QStringLiteral("Invalid control message syntax"));
-            return;
-        }
+    // 6xx replies are asynchronous events; they never come in the middle of
+    // a command's reply, so they don't touch the command queue at all
+    if (reply.isEvent()) {
+        if (!currentCommand) {
+            const std::string_view event = reply.eventName();
+            currentCommand = eventCommands.value(QByteArray::fromRawData(event.data(), static_cast<int>(event.size())));
 
-        // 6xx replies are asynchronous responses
-        if (statusCode >= 600 && statusCode < 700) {
             if (!currentCommand) {
-                int space = line.indexOf(' ');
-                if (space > 0)
-                    currentCommand = eventCommands.value(line.mid(0, space));
-
-                if (!currentCommand) {
-                    qWarning() << "torctrl: Ignoring unknown event";
-                    continue;
-                }
+                qWarning() << "torctrl: Ignoring unknown event";
+                return;
             }
-
-            currentCommand->onReply(statusCode, line);
-            if (isFinalReply) {
-                currentCommand->onFinished(statusCode);
-                currentCommand = 0;
-            }
-            continue;
         }
 
-        if (commandQueue.isEmpty()) {
-            qWarning() << "torctrl: Received unexpected data";
-            continue;
+        currentCommand->onReply(reply.statusCode, toByteArray(reply.data));
+        if (reply.isFinal()) {
+            currentCommand->onFinished(reply.statusCode);
+            currentCommand = 0;
         }
+        return;
+    }
 
-        TorControlCommand *command = commandQueue.first();
-        if (command)
-            command->onReply(statusCode, line);
-
-        if (inDataReply) {
-            currentCommand = command;
-        } else if (isFinalReply) {
-            commandQueue.takeFirst();
-            if (command) {
-                command->onFinished(statusCode);
-                command->deleteLater();
-            }
+    if (commandQueue.isEmpty()) {
+        qWarning() << "torctrl: Received unexpected data";
+        return;
+    }
+
+    TorControlCommand *command = commandQueue.first();
+    if (reply.isFinal())
+        commandQueue.takeFirst();
+    else if (inDataReply)
+        currentCommand = command;
+
+    if (command) {
+        command->onReply(reply.statusCode, toByteArray(reply.data));
+        if (reply.isFinal()) {
+            command->onFinished(reply.statusCode);
+            command->deleteLater();
         }
     }
 }
@@ -33,6 +33,8 @@
 #ifndef TORCONTROLSOCKET_H
 #define TORCONTROLSOCKET_H
 
+#include "TorControlReply.h"
+
 namespace Tor
 {
 
@@ -47,8 +49,12 @@ public:
 
     QString errorMessage() const { return m_errorMessage; }
 
-    void registerEvent(const QByteArray &event, TorControlCommand *handler);
+    /* Registers events with a single SETEVENTS */
+    void registerEvents(const QHash<QByteArray,TorControlCommand*> &handlers);
 
+    /* Commands are written immediately, without waiting for the replies to
+     * earlier ones; tor answers them in order, so each reply goes to the
+     * oldest command still in flight. */
     void sendCommand(const QByteArray &data) { sendCommand(0, data); }
     void sendCommand(TorControlCommand *command, const QByteArray &data);
 
@@ -63,10 +69,12 @@ private:
     QQueue<TorControlCommand*> commandQueue;
     QHash<QByteArray,TorControlCommand*> eventCommands;
     QString m_errorMessage;
+    TorControlLineBuffer readBuffer;
     TorControlCommand *currentCommand;
     bool inDataReply;
 
     void setError(const QString &message);
+    void processLine(std::string_view line);
 };
 
 }
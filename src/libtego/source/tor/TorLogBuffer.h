@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Tor
+{
+
+/* Keeps the most recent tor log messages, as UTF-8, in a fixed number of
+ * slots. Every message gets a sequence number, starting at 1, so a reader
+ * can remember where it stopped and later read only what came after.
+ *
+ * Slots are reused in place: once the buffer has filled up, storing a
+ * message only allocates if it is longer than any the slot held before. */
+class TorLogBuffer
+{
+public:
+    static constexpr size_t DefaultCapacity = 256;
+
+    explicit TorLogBuffer(size_t capacity = DefaultCapacity)
+        : m_slots(std::max<size_t>(capacity, 1))
+    {
+    }
+
+    size_t capacity() const { return m_slots.size(); }
+    // number of messages retained
+    size_t size() const { return m_size; }
+    // total length of the messages retained, in bytes
+    size_t byteSize() const { return m_bytes; }
+
+    // sequence number of the oldest message retained, or of the next one when empty
+    uint64_t firstSequence() const { return m_next - m_size; }
+    // sequence number the next message will get
+    uint64_t nextSequence() const { return m_next; }
+
+    // store a message, dropping the oldest one if full; returns its sequence number
+    uint64_t append(std::string_view message)
+    {
+        std::string &slot = slotFor(m_next);
+        if (m_size == capacity())
+            m_bytes -= slot.size();
+        else
+            ++m_size;
+
+        slot.assign(message.data(), message.size());
+        m_bytes += slot.size();
+        return m_next++;
+    }
+
+    /* Calls f(sequence, message) for each retained message numbered since or
+     * later, oldest first, until f returns false. Messages dropped before they
+     * could be read are skipped. Returns the sequence number to continue from.
+     *
+     * The views point into the buffer and are valid until the next append(). */
+    template<typename F>
+    uint64_t readSince(uint64_t since, F &&f) const
+    {
+        uint64_t sequence = std::max(since, firstSequence());
+        for (; sequence < m_next; ++sequence) {
+            if (!f(sequence, std::string_view(slotFor(sequence))))
+                break;
+        }
+        return std::max(sequence, since);
+    }
+
+private:
+    std::vector<std::string> m_slots;
+    size_t m_size = 0;
+    size_t m_bytes = 0;
+    uint64_t m_next = 1;
+
+    std::string &slotFor(uint64_t sequence) { return m_slots[(sequence - 1) % m_slots.size()]; }
+    const std::string &slotFor(uint64_t sequence) const { return m_slots[(sequence - 1) % m_slots.size()]; }
+};
+
+}
@@ -33,6 +33,7 @@
 #include "TorManager.h"
 #include "TorProcess.h"
 #include "TorControl.h"
+#include "TorLogBuffer.h"
 #include "GetConfCommand.h"
 
 #include "error.hpp"
@@ -56,7 +57,7 @@ public:
     TorProcess *process;
     TorControl *control;
     QString dataDir;
-    QStringList logMessages;
+    TorLogBuffer logs;
     QString errorMessage;
 
     explicit TorManagerPrivate(TorManager *parent = 0);
@@ -120,9 +121,9 @@ void TorManager::setDataDirectory(const QString &path)
         d->dataDir.append(QLatin1Char('/'));
 }
 
-QStringList TorManager::logMessages() const
+const TorLogBuffer &TorManager::logs() const
 {
-    return d->logMessages;
+    return d->logs;
 }
 
 QString TorManager::running() const
@@ -248,15 +249,13 @@ void TorManagerPrivate::processErrorChanged(const QString &message)
 void TorManagerPrivate::processLogMessage(const QString &message)
 {
     qDebug() << "tor:" << message;
-    if (logMessages.size() >= 50)
-        logMessages.takeFirst();
-    logMessages.append(message);
+
+    auto utf8 = message.toUtf8();
+    logs.append(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
 
     emit q->logMessage(message);
 
     // marshall message out of the QString into our own char buffer
-    auto utf8 = message.toUtf8();
-
     const auto msgLength = utf8.size();
     const auto msgSize = msgLength + 1;
     auto msg = std::make_unique<char[]>(static_cast<size_t>(msgSize));
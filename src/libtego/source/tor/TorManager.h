@@ -38,6 +38,7 @@ namespace Tor
 
 class TorProcess;
 class TorControl;
+class TorLogBuffer;
 class TorManagerPrivate;
 
 /* Run/connect to an instance of Tor according to configuration, and manage
@@ -55,7 +56,7 @@ public:
     QString dataDirectory() const;
     void setDataDirectory(const QString &path);
 
-    QStringList logMessages() const;
+    const TorLogBuffer &logs() const;
     QString running() const;
 
     bool hasError() const;
@@ -35,19 +35,25 @@ using tego::g_globals;
 
 #include "TorSocket.h"
 #include "TorControl.h"
+#include "TorSocketScheduler.h"
 
 using namespace Tor;
 
 TorSocket::TorSocket(QObject *parent)
     : QTcpSocket(parent)
     , m_port(0)
+    , m_openMode(ReadWrite)
+    , m_protocol(AnyIPProtocol)
+    , m_scheduler(g_globals.context->torControl->socketScheduler())
     , m_reconnectEnabled(true)
     // 10 minutes
     , m_maxInterval(600)
-    , m_connectAttempts(0)
+    , m_lastInterval(0)
+    , m_priority(0)
 {
     connect(g_globals.context->torControl, SIGNAL(connectivityChanged()), SLOT(connectivityChanged()));
     connect(&m_connectTimer, SIGNAL(timeout()), SLOT(reconnect()));
+    connect(this, SIGNAL(connected()), SLOT(onConnected()));
     connect(this, SIGNAL(disconnected()), SLOT(onFailed()));
     connect(this, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(onFailed()));
 
@@ -57,6 +63,8 @@ TorSocket::TorSocket(QObject *parent)
 
 TorSocket::~TorSocket()
 {
+    if (m_scheduler)
+        m_scheduler->cancel(this);
 }
 
 void TorSocket::setReconnectEnabled(bool enabled)
@@ -66,10 +74,13 @@ void TorSocket::setReconnectEnabled(bool enabled)
 
     m_reconnectEnabled = enabled;
     if (m_reconnectEnabled) {
-        m_connectAttempts = 0;
+        m_lastInterval = 0;
         reconnect();
     } else {
         m_connectTimer.stop();
+        // an attempt already under way keeps its slot until it's over
+        if (m_scheduler && m_scheduler->isWaiting(this))
+            m_scheduler->cancel(this);
     }
 }
 
@@ -80,7 +91,7 @@ void TorSocket::setMaxAttemptInterval(int interval)
 
 void TorSocket::resetAttempts()
 {
-    m_connectAttempts = 0;
+    m_lastInterval = 0;
     if (m_connectTimer.isActive()) {
         m_connectTimer.stop();
         m_connectTimer.start(reconnectInterval() * 1000);
@@ -89,25 +100,8 @@ void TorSocket::resetAttempts()
 
 int TorSocket::reconnectInterval()
 {
-    int delay = 0;
-    // 10 attempts with 30s delay -> 0 - 5 minutes
-    if (m_connectAttempts <= 10) {
-        delay = 30;
-    }
-    // 5 attempts with 60s delay -> 5 - 10 minutes
-    else if (m_connectAttempts <= 15) {
-        delay = 60;
-    }
-    // 5 attempts with 120s delay -> 10 - 20 minutes
-    else if (m_connectAttempts <= 20) {
-        delay = 120;
-    }
-    // max delay ever after (10 minutes default)
-    else {
-        delay = m_maxInterval;
-    }
-
-    return qMin(delay, m_maxInterval);
+    m_lastInterval = TorSocketScheduler::nextBackoff(m_lastInterval, BaseInterval, qMax(BaseInterval, m_maxInterval));
+    return m_lastInterval;
 }
 
 void TorSocket::reconnect()
@@ -130,7 +124,9 @@ void TorSocket::connectivityChanged()
             reconnect();
     } else {
         m_connectTimer.stop();
-        m_connectAttempts = 0;
+        m_lastInterval = 0;
+        if (m_scheduler)
+            m_scheduler->cancel(this);
     }
 }
 
@@ -139,14 +135,32 @@ void TorSocket::connectToHost(const QString &hostName, quint16 port, OpenMode op
 {
     m_host = hostName;
     m_port = port;
+    m_openMode = openMode;
+    m_protocol = protocol;
 
     if (!g_globals.context->torControl->hasConnectivity())
         return;
 
+    if (!m_scheduler) {
+        startConnecting();
+        return;
+    }
+    m_scheduler->request(this, m_priority, [this]() { startConnecting(); });
+}
+
+void TorSocket::startConnecting()
+{
+    // things may have changed while this socket waited for its turn
+    if (state() != QAbstractSocket::UnconnectedState || !g_globals.context->torControl->hasConnectivity()) {
+        if (m_scheduler)
+            m_scheduler->finished(this, state() == QAbstractSocket::ConnectedState);
+        return;
+    }
+
     if (proxy() != g_globals.context->torControl->connectionProxy())
         setProxy(g_globals.context->torControl->connectionProxy());
 
-    QAbstractSocket::connectToHost(hostName, port, openMode, protocol);
+    QAbstractSocket::connectToHost(m_host, m_port, m_openMode, m_protocol);
 }
 
 void TorSocket::connectToHost(const QHostAddress &address, quint16 port, OpenMode openMode)
@@ -154,14 +168,22 @@ void TorSocket::connectToHost(const QHostAddress &address, quint16 port, OpenMod
     TorSocket::connectToHost(address.toString(), port, openMode);
 }
 
+void TorSocket::onConnected()
+{
+    if (m_scheduler)
+        m_scheduler->finished(this, true);
+}
+
 void TorSocket::onFailed()
 {
+    if (m_scheduler)
+        m_scheduler->finished(this, false);
+
     // Make sure the internal connection to the SOCKS proxy is closed
     // Otherwise reconnect attempts will fail (#295)
     close();
 
     if (reconnectEnabled() && !m_connectTimer.isActive()) {
-        m_connectAttempts++;
         m_connectTimer.start(reconnectInterval() * 1000);
         qDebug() << "Reconnecting socket to" << m_host << m_port << "in" << m_connectTimer.interval() / 1000 << "seconds";
     }
@@ -35,6 +35,8 @@
 
 namespace Tor {
 
+class TorSocketScheduler;
+
 /* Specialized QTcpSocket which makes connections over the SOCKS proxy
  * from a TorControl instance, automatically attempts reconnections, and
  * reacts to Tor's connectivity state.
@@ -47,6 +49,10 @@ namespace Tor {
  * setReconnectEnabled(false) and disconnect the socket with
  * disconnectFromHost or abort.
  *
+ * Attempts go through TorControl's TorSocketScheduler, which limits how
+ * many sockets connect at once; setPriority() orders this socket among
+ * the ones waiting. Retry intervals back off with random jitter.
+ *
  * The caller is responsible for resetting the attempt counter if a
  * connection was successful and reconnection will be used again.
  */
@@ -63,6 +69,9 @@ public:
     int maxAttemptInterval() { return m_maxInterval; }
     void setMaxAttemptInterval(int interval);
     void resetAttempts();
+    /* Higher goes first when waiting to connect, e.g. the time a contact was last online */
+    qint64 priority() const { return m_priority; }
+    void setPriority(qint64 priority) { m_priority = priority; }
 
     virtual void connectToHost(const QString &hostName, quint16 port, OpenMode openMode = ReadWrite, NetworkLayerProtocol protocol = AnyIPProtocol);
     virtual void connectToHost(const QHostAddress &address, quint16 port, OpenMode openMode = ReadWrite);
@@ -76,15 +85,26 @@ protected:
 private slots:
     void reconnect();
     void connectivityChanged();
+    void onConnected();
     void onFailed();
 
 private:
+    // shortest retry interval, in seconds
+    static constexpr int BaseInterval = 15;
+
     QString m_host;
     quint16 m_port;
+    OpenMode m_openMode;
+    NetworkLayerProtocol m_protocol;
     QTimer m_connectTimer;
+    QPointer<TorSocketScheduler> m_scheduler;
     bool m_reconnectEnabled;
     int m_maxInterval;
-    int m_connectAttempts;
+    // the last retry interval, in seconds; 0 before the first failure
+    int m_lastInterval;
+    qint64 m_priority;
+
+    void startConnecting();
 
     using QAbstractSocket::connectToHost;
 };
@@ -0,0 +1,129 @@
+#include "TorSocketScheduler.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QRandomGenerator>
+
+using namespace Tor;
+
+TorSocketScheduler::TorSocketScheduler(int maxActive, QObject *parent)
+    : QObject(parent)
+    , m_maxActive(qMax(1, maxActive))
+    , m_sequence(0)
+    , m_starting(false)
+    , m_backlogged(false)
+{
+}
+
+void TorSocketScheduler::setMaxActive(int maxActive)
+{
+    m_maxActive = qMax(1, maxActive);
+    startWaiting();
+}
+
+void TorSocketScheduler::request(QObject *owner, qint64 priority, std::function<void()> start)
+{
+    Q_ASSERT(owner);
+    // already connecting; it will report back through finished()
+    if (m_active.contains(owner))
+        return;
+
+    qint64 queuedAt = QDateTime::currentMSecsSinceEpoch();
+    quint64 sequence = m_sequence++;
+    auto it = m_waitingKeys.find(owner);
+    if (it != m_waitingKeys.end()) {
+        // keep its place among equals, and how long it has waited
+        auto node = m_waiting.extract(it.value());
+        sequence = node.key().second;
+        queuedAt = node.mapped().queuedAt;
+        m_waitingKeys.erase(it);
+    }
+
+    const Key key(-priority, sequence);
+    m_waiting.emplace(key, Waiting{owner, std::move(start), queuedAt});
+    m_waitingKeys.insert(owner, key);
+
+    startWaiting();
+}
+
+void TorSocketScheduler::finished(QObject *owner, bool succeeded)
+{
+    if (!m_active.remove(owner))
+        return;
+
+    if (succeeded)
+        m_stats.succeeded++;
+    else
+        m_stats.failed++;
+
+    startWaiting();
+}
+
+void TorSocketScheduler::cancel(QObject *owner)
+{
+    auto it = m_waitingKeys.find(owner);
+    if (it != m_waitingKeys.end()) {
+        m_waiting.erase(it.value());
+        m_waitingKeys.erase(it);
+    }
+
+    if (m_active.remove(owner))
+        startWaiting();
+    else
+        reportIfDrained();
+}
+
+TorSocketScheduler::Stats TorSocketScheduler::stats() const
+{
+    Stats stats = m_stats;
+    stats.waiting = static_cast<int>(m_waiting.size());
+    stats.active = static_cast<int>(m_active.size());
+    stats.maxActive = m_maxActive;
+    return stats;
+}
+
+void TorSocketScheduler::startWaiting()
+{
+    // a start function may finish or cancel synchronously; the outer call keeps going
+    if (m_starting)
+        return;
+    m_starting = true;
+
+    while (!m_waiting.empty() && m_active.size() < m_maxActive) {
+        auto node = m_waiting.extract(m_waiting.begin());
+        Waiting &waiting = node.mapped();
+        m_waitingKeys.remove(waiting.owner);
+        m_active.insert(waiting.owner);
+
+        m_stats.started++;
+        m_stats.longestWait = qMax(m_stats.longestWait, QDateTime::currentMSecsSinceEpoch() - waiting.queuedAt);
+
+        waiting.start();
+    }
+
+    m_starting = false;
+    reportIfDrained();
+}
+
+void TorSocketScheduler::reportIfDrained()
+{
+    if (!m_waiting.empty()) {
+        m_backlogged = true;
+        return;
+    }
+    if (!m_backlogged)
+        return;
+
+    m_backlogged = false;
+    const Stats s = stats();
+    qDebug() << "Socket connection queue drained:" << s.started << "started," << s.succeeded << "succeeded,"
+             << s.failed << "failed," << s.active << "of" << s.maxActive << "still active, longest wait"
+             << s.longestWait << "ms";
+}
+
+int TorSocketScheduler::nextBackoff(int previous, int base, int cap)
+{
+    Q_ASSERT(base > 0 && cap >= base);
+    const int upper = static_cast<int>(qMin<qint64>(cap, qMax<qint64>(base, previous) * 3));
+    return base + QRandomGenerator::global()->bounded(upper - base + 1);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QHash>
+#include <QSet>
+#include <QObject>
+#include <functional>
+#include <map>
+#include <utility>
+
+namespace Tor
+{
+
+/* Decides when TorSockets may start a connection attempt.
+ *
+ * Every offline contact keeps a socket that retries on its own schedule,
+ * and all of them want to reconnect the moment tor regains connectivity.
+ * Rather than letting each start building a circuit straight away, sockets
+ * queue here and at most maxActive attempts run at a time. Waiting sockets
+ * are started highest priority first (contacts that were online most
+ * recently), and in the order they asked among equals.
+ */
+class TorSocketScheduler : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(TorSocketScheduler)
+
+public:
+    struct Stats
+    {
+        // queued for a slot
+        int waiting = 0;
+        // attempts in progress
+        int active = 0;
+        int maxActive = 0;
+        quint64 started = 0;
+        quint64 succeeded = 0;
+        quint64 failed = 0;
+        // longest time a socket has spent queued, in milliseconds
+        qint64 longestWait = 0;
+    };
+
+    static constexpr int DefaultMaxActive = 8;
+
+    explicit TorSocketScheduler(int maxActive = DefaultMaxActive, QObject *parent = nullptr);
+
+    int maxActive() const { return m_maxActive; }
+    void setMaxActive(int maxActive);
+
+    /* Queue an attempt for owner; start is called, possibly right away, once
+     * a slot is free. Asking again while queued only updates the request. */
+    void request(QObject *owner, qint64 priority, std::function<void()> start);
+    /* The owner's attempt is over, freeing its slot */
+    void finished(QObject *owner, bool succeeded);
+    /* Forget the owner's request or slot, e.g. because it is going away */
+    void cancel(QObject *owner);
+
+    bool isWaiting(QObject *owner) const { return m_waitingKeys.contains(owner); }
+    bool isActive(QObject *owner) const { return m_active.contains(owner); }
+
+    Stats stats() const;
+
+    /* Decorrelated jitter: a random delay between base and three times the
+     * previous one, at most cap. Sockets that failed together spread out
+     * instead of retrying in lockstep. */
+    static int nextBackoff(int previous, int base, int cap);
+
+private:
+    // highest priority first, then first come first served
+    using Key = std::pair<qint64, quint64>;
+
+    struct Waiting
+    {
+        QObject *owner;
+        std::function<void()> start;
+        qint64 queuedAt;
+    };
+
+    std::map<Key, Waiting> m_waiting;
+    QHash<QObject*, Key> m_waitingKeys;
+    QSet<QObject*> m_active;
+    int m_maxActive;
+    quint64 m_sequence;
+    bool m_starting;
+    // sockets have had to queue since the queue was last empty
+    bool m_backlogged;
+    Stats m_stats;
+
+    void startWaiting();
+    // logs the stats once a backlog of waiting sockets has been worked through
+    void reportIfDrained();
+};
+
+}
@@ -0,0 +1,204 @@
+#include <catch2/catch.hpp>
+
+#include <openssl/evp.h>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTemporaryDir>
+#include <QThreadPool>
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "file_hash.hpp"
+#include "file_hash_cache.hpp"
+
+using tego::file_hash_cache;
+
+namespace
+{
+    QString writeFile(const QTemporaryDir &dir, const QString &name, const QByteArray &contents)
+    {
+        const QString path = dir.filePath(name);
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        REQUIRE(file.write(contents) == contents.size());
+        return path;
+    }
+
+    std::string hashOf(const QByteArray &contents)
+    {
+        const auto begin = reinterpret_cast<const uint8_t*>(contents.constData());
+        return tego_file_hash(begin, begin + contents.size()).to_string();
+    }
+
+    // shared_future::get() refers into the shared state, so two futures
+    // came from the same hashing job exactly when these match
+    const tego_file_hash *job(const std::shared_future<tego_file_hash> &hash)
+    {
+        return &hash.get();
+    }
+}
+
+TEST_CASE(  "file_hash_cache hashes a file once for concurrent requests",
+            "[libtego][file_hash_cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QByteArray contents(1 << 20, 'x');
+    const QString path = writeFile(dir, QStringLiteral("file"), contents);
+
+    file_hash_cache cache;
+    auto first = cache.hash_file(path, nullptr, {});
+    auto second = cache.hash_file(path, nullptr, {});
+
+    REQUIRE(first.get().to_string() == hashOf(contents));
+    REQUIRE(job(first) == job(second));
+
+    // once done, the remembered hash is handed out ready
+    auto third = cache.hash_file(path, nullptr, {});
+    REQUIRE(third.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    REQUIRE(job(third) == job(first));
+}
+
+TEST_CASE(  "file_hash_cache hashes a file again once it changes",
+            "[libtego][file_hash_cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = writeFile(dir, QStringLiteral("file"), "first");
+
+    file_hash_cache cache;
+    auto first = cache.hash_file(path, nullptr, {});
+    REQUIRE(first.get().to_string() == hashOf("first"));
+
+    // a different size
+    writeFile(dir, QStringLiteral("file"), "second");
+    auto second = cache.hash_file(path, nullptr, {});
+    REQUIRE(job(second) != job(first));
+    REQUIRE(second.get().to_string() == hashOf("second"));
+
+    // the same size, only the modification time tells them apart
+    writeFile(dir, QStringLiteral("file"), "third!");
+    {
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(file.setFileTime(QDateTime::currentDateTimeUtc().addSecs(60), QFileDevice::FileModificationTime));
+    }
+    auto third = cache.hash_file(path, nullptr, {});
+    REQUIRE(job(third) != job(second));
+    REQUIRE(third.get().to_string() == hashOf("third!"));
+}
+
+TEST_CASE(  "file_hash_cache forgets failed hashes",
+            "[libtego][file_hash_cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = writeFile(dir, QStringLiteral("file"), "contents");
+
+    file_hash_cache cache;
+    REQUIRE_THROWS(cache.hash_file(dir.filePath(QStringLiteral("missing")), nullptr, {}));
+
+    REQUIRE(QFile::setPermissions(path, QFileDevice::Permissions()));
+    QFile probe(path);
+    if (probe.open(QIODevice::ReadOnly))
+    {
+        WARN("file permissions are not enforced for this user, skipping the failed hash");
+        return;
+    }
+
+    auto failed = cache.hash_file(path, nullptr, {});
+    REQUIRE_THROWS(failed.get());
+
+    // the next request tries again rather than returning the failure
+    REQUIRE(QFile::setPermissions(path, QFileDevice::ReadOwner | QFileDevice::WriteOwner));
+    auto retried = cache.hash_file(path, nullptr, {});
+    REQUIRE(retried.get().to_string() == hashOf("contents"));
+}
+
+TEST_CASE(  "file_hash_cache drops completed hashes beyond MaxEntries",
+            "[libtego][file_hash_cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    file_hash_cache cache;
+    std::vector<std::shared_future<tego_file_hash>> hashes;
+    for (size_t i = 0; i < file_hash_cache::MaxEntries; ++i)
+    {
+        const QString path = writeFile(dir, QString::number(i), QByteArray::number(static_cast<qulonglong>(i)));
+        hashes.push_back(cache.hash_file(path, nullptr, {}));
+    }
+    for (const auto &hash : hashes)
+    {
+        hash.wait();
+    }
+
+    // everything is still remembered while there is room
+    REQUIRE(job(cache.hash_file(dir.filePath(QStringLiteral("0")), nullptr, {})) == job(hashes[0]));
+
+    // one more file goes past the limit and the completed entries are dropped
+    const QString extra = writeFile(dir, QStringLiteral("extra"), "extra");
+    cache.hash_file(extra, nullptr, {}).wait();
+
+    auto again = cache.hash_file(dir.filePath(QStringLiteral("0")), nullptr, {});
+    REQUIRE(job(again) != job(hashes[0]));
+    REQUIRE(again.get().to_string() == hashes[0].get().to_string());
+}
+
+TEST_CASE(  "file_hash_cache notifies receivers that still exist",
+            "[libtego][file_hash_cache]")
+{
+    int argc = 1;
+    char arg0[] = "libtego_tests";
+    char *argv[] = {arg0, nullptr};
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = writeFile(dir, QStringLiteral("file"), QByteArray(1 << 20, 'x'));
+    const QString other = writeFile(dir, QStringLiteral("other"), QByteArray(1 << 20, 'y'));
+
+    file_hash_cache cache;
+    QObject receiver;
+    auto gone = new QObject;
+    int notified = 0;
+    int notifiedGone = 0;
+    auto hash = cache.hash_file(path, &receiver, [&]() { ++notified; });
+    auto otherHash = cache.hash_file(other, gone, [&]() { ++notifiedGone; });
+    delete gone;
+
+    hash.wait();
+    otherHash.wait();
+    QElapsedTimer timer;
+    timer.start();
+    while (notified == 0 && timer.elapsed() < 10000)
+    {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+    }
+    QCoreApplication::processEvents();
+
+    REQUIRE(notified == 1);
+    REQUIRE(notifiedGone == 0);
+
+    // a hash that is already known is returned ready, without a notification
+    auto known = cache.hash_file(path, &receiver, [&]() { ++notified; });
+    REQUIRE(known.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    QCoreApplication::processEvents();
+    REQUIRE(notified == 1);
+}
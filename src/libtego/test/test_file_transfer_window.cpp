@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <tego/tego.h>
+
+#include "protocol/FileTransferWindow.h"
+
+using namespace Protocol;
+
+TEST_CASE(  "FileTransferWindow sends until the window is full and advances on acks",
+            "[libtego][protocol][file]")
+{
+    constexpr tego_file_size_t Chunk = 100;
+    constexpr tego_file_size_t Window = 3 * Chunk;
+
+    FileTransferWindow window(1050);
+    REQUIRE(window.canSend(Window));
+
+    for (int i = 0; i < 3; i++)
+    {
+        window.sent(Chunk);
+    }
+    REQUIRE(window.inFlight() == Window);
+    REQUIRE_FALSE(window.canSend(Window));
+
+    // every ack makes room for as many bytes as it acknowledges
+    REQUIRE(window.acknowledge(Chunk));
+    REQUIRE(window.acked == Chunk);
+    REQUIRE(window.inFlight() == 2 * Chunk);
+    REQUIRE(window.canSend(Window));
+
+    // acks are cumulative, so one may cover several chunks
+    window.sent(Chunk);
+    REQUIRE(window.acknowledge(window.offset));
+    REQUIRE(window.inFlight() == 0);
+
+    // the last chunk may be short, and nothing is sent once everything was
+    while (!window.finished())
+    {
+        while (window.canSend(Window))
+        {
+            window.sent(std::min(Chunk, window.size - window.offset));
+        }
+        REQUIRE(window.inFlight() <= Window);
+        REQUIRE(window.acknowledge(window.offset));
+    }
+    REQUIRE(window.offset == window.size);
+    REQUIRE_FALSE(window.canSend(Window));
+    REQUIRE(window.inFlight() == 0);
+}
+
+TEST_CASE(  "FileTransferWindow rejects acks that don't move forward within what was sent",
+            "[libtego][protocol][file]")
+{
+    FileTransferWindow window(1000);
+
+    // nothing sent yet
+    REQUIRE_FALSE(window.acknowledge(0));
+    REQUIRE_FALSE(window.acknowledge(1));
+
+    window.sent(300);
+    REQUIRE(window.acknowledge(200));
+
+    // repeated, backwards, and past what we have sent
+    REQUIRE_FALSE(window.acknowledge(200));
+    REQUIRE_FALSE(window.acknowledge(100));
+    REQUIRE_FALSE(window.acknowledge(301));
+    REQUIRE_FALSE(window.acknowledge(1000));
+
+    // a rejected ack leaves the window as it was
+    REQUIRE(window.acked == 200);
+    REQUIRE(window.offset == 300);
+    REQUIRE(window.acknowledge(300));
+}
+
+TEST_CASE(  "FileTransferWindow handles empty files",
+            "[libtego][protocol][file]")
+{
+    FileTransferWindow window(0);
+    REQUIRE(window.finished());
+    REQUIRE_FALSE(window.canSend(1));
+    REQUIRE_FALSE(window.acknowledge(0));
+}
@@ -0,0 +1,105 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+#include <tego/tego.h>
+#include <tego/tego.hpp>
+
+#include "lock_stats.hpp"
+
+TEST_CASE(  "instrumented_mutex counts acquisitions and hold time",
+            "[libtego][locks]")
+{
+    tego::instrumented_mutex mutex("test");
+
+    {
+        std::lock_guard<tego::instrumented_mutex> lock(mutex);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    REQUIRE(mutex.try_lock());
+    mutex.unlock();
+
+    const auto stats = mutex.stats();
+    REQUIRE(stats.acquisitions == 2);
+    REQUIRE(stats.contended == 0);
+    REQUIRE(stats.total_wait == 0);
+    REQUIRE(stats.max_hold >= 2'000'000);
+    REQUIRE(stats.total_hold >= stats.max_hold);
+}
+
+TEST_CASE(  "instrumented_mutex counts contention",
+            "[libtego][locks]")
+{
+    tego::instrumented_mutex mutex("test");
+    std::atomic_bool held = false;
+
+    mutex.lock();
+    REQUIRE_FALSE(mutex.try_lock());
+
+    std::thread waiter([&]()
+    {
+        held = true;
+        std::lock_guard<tego::instrumented_mutex> lock(mutex);
+    });
+    while (!held)
+    {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    mutex.unlock();
+    waiter.join();
+
+    const auto stats = mutex.stats();
+    REQUIRE(stats.acquisitions == 2);
+    REQUIRE(stats.contended == 1);
+    REQUIRE(stats.total_wait > 0);
+}
+
+TEST_CASE(  "instrumented_mutex works with condition_variable_any",
+            "[libtego][locks]")
+{
+    tego::instrumented_mutex mutex("test");
+    std::condition_variable_any wakeup;
+    bool ready = false;
+
+    std::thread notifier([&]()
+    {
+        {
+            std::lock_guard<tego::instrumented_mutex> lock(mutex);
+            ready = true;
+        }
+        wakeup.notify_one();
+    });
+
+    {
+        std::unique_lock<tego::instrumented_mutex> lock(mutex);
+        wakeup.wait(lock, [&]() { return ready; });
+        REQUIRE(ready);
+    }
+    notifier.join();
+
+    REQUIRE(mutex.stats().acquisitions >= 2);
+}
+
+TEST_CASE(  "Lock stats can be read through the context",
+            "[libtego][locks][context]")
+{
+    tego_context* context = nullptr;
+    REQUIRE_NOTHROW(tego_initialize(&context, tego::throw_on_error()));
+
+    for (auto lock : {tego_lock_callback_queue, tego_lock_file_hash_cache})
+    {
+        tego_lock_stats_t stats = {};
+        REQUIRE_NOTHROW(tego_context_get_lock_stats(context, lock, &stats, tego::throw_on_error()));
+        REQUIRE(stats.contended <= stats.acquisitions);
+        REQUIRE(stats.maxHoldNs <= stats.totalHoldNs);
+    }
+
+    tego_lock_stats_t stats = {};
+    REQUIRE_THROWS(tego_context_get_lock_stats(context, static_cast<tego_lock_t>(-1), &stats, tego::throw_on_error()));
+    REQUIRE_THROWS(tego_context_get_lock_stats(context, tego_lock_callback_queue, nullptr, tego::throw_on_error()));
+
+    tego_uninitialize(context, nullptr);
+}
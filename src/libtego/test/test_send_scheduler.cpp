@@ -0,0 +1,200 @@
+#include <catch2/catch.hpp>
+
+#include <QByteArray>
+#include <QtEndian>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "protocol/SendScheduler.h"
+
+using namespace Protocol;
+
+namespace
+{
+    // Channel::Priority
+    constexpr int Control = 0;
+    constexpr int Chat = 1;
+    constexpr int Bulk = 2;
+
+    void queue(SendScheduler &scheduler, int channelId, int priority, int dataSize, char fill = 'x')
+    {
+        char *data = scheduler.beginFrame(channelId, priority, dataSize);
+        REQUIRE(data != nullptr);
+        std::memset(data, fill, static_cast<size_t>(dataSize));
+    }
+
+    // (channel id, frame size) of each frame in out
+    std::vector<std::pair<int,int>> frames(const QByteArray &out)
+    {
+        std::vector<std::pair<int,int>> result;
+        for (int offset = 0; offset < out.size();) {
+            const uchar *header = reinterpret_cast<const uchar*>(out.constData() + offset);
+            const int size = qFromBigEndian<quint16>(header);
+            REQUIRE(size >= SendScheduler::FrameHeaderSize);
+            result.emplace_back(qFromBigEndian<quint16>(&header[2]), size);
+            offset += size;
+        }
+        return result;
+    }
+
+    std::vector<int> channels(const QByteArray &out)
+    {
+        std::vector<int> result;
+        for (const auto &frame : frames(out))
+            result.push_back(frame.first);
+        return result;
+    }
+}
+
+TEST_CASE(  "SendScheduler sends control, then chat, then bulk",
+            "[libtego][protocol][scheduler]")
+{
+    SendScheduler scheduler(SendScheduler::FrameMaxSize, 1 << 20, 1 << 19);
+
+    queue(scheduler, 5, Bulk, 100);
+    queue(scheduler, 3, Chat, 10);
+    queue(scheduler, 0, Control, 2);
+    queue(scheduler, 5, Bulk, 100);
+    queue(scheduler, 3, Chat, 10);
+    REQUIRE(scheduler.queuedBytes() == 2 * 104 + 2 * 14 + 6);
+
+    QByteArray out;
+    REQUIRE(scheduler.take(scheduler.queuedBytes(), out) == 242);
+    REQUIRE(out.size() == 242);
+    REQUIRE(channels(out) == std::vector<int>{0, 3, 3, 5, 5});
+    REQUIRE(scheduler.queuedBytes() == 0);
+    REQUIRE_FALSE(scheduler.contains(5));
+
+    // frames come out whole and unchanged
+    const auto sizes = frames(out);
+    REQUIRE(sizes[0].second == 6);
+    REQUIRE(sizes[3].second == 104);
+    REQUIRE(out.mid(out.size() - 100) == QByteArray(100, 'x'));
+}
+
+TEST_CASE(  "SendScheduler lets control and chat overtake queued bulk data",
+            "[libtego][protocol][scheduler]")
+{
+    SendScheduler scheduler(SendScheduler::FrameMaxSize, 1 << 20, 1 << 19);
+
+    for (int i = 0; i < 4; i++)
+        queue(scheduler, 7, Bulk, 996);
+
+    // a budget only stops whole frames from being taken once it is used up
+    QByteArray out;
+    REQUIRE(scheduler.take(1500, out) == 2000);
+    REQUIRE(channels(out) == std::vector<int>{7, 7});
+
+    queue(scheduler, 3, Chat, 10);
+    queue(scheduler, 1, Control, 10);
+
+    out.clear();
+    scheduler.take(1, out);
+    REQUIRE(channels(out) == std::vector<int>{1});
+    out.clear();
+    scheduler.take(1, out);
+    REQUIRE(channels(out) == std::vector<int>{3});
+    out.clear();
+    scheduler.take(scheduler.queuedBytes(), out);
+    REQUIRE(channels(out) == std::vector<int>{7, 7});
+}
+
+TEST_CASE(  "SendScheduler shares a class between channels by deficit round-robin",
+            "[libtego][protocol][scheduler]")
+{
+    SECTION("equal frames alternate")
+    {
+        SendScheduler scheduler(104, 1 << 20, 1 << 19);
+        for (int i = 0; i < 3; i++) {
+            queue(scheduler, 5, Bulk, 100);
+            queue(scheduler, 9, Bulk, 100);
+        }
+
+        QByteArray out;
+        scheduler.take(scheduler.queuedBytes(), out);
+        REQUIRE(channels(out) == std::vector<int>{5, 9, 5, 9, 5, 9});
+    }
+
+    SECTION("channels with small frames don't get more bytes")
+    {
+        SendScheduler scheduler(400, 1 << 20, 1 << 19);
+        for (int i = 0; i < 2; i++)
+            queue(scheduler, 5, Bulk, 396);
+        for (int i = 0; i < 8; i++)
+            queue(scheduler, 9, Bulk, 96);
+
+        QByteArray out;
+        scheduler.take(scheduler.queuedBytes(), out);
+        REQUIRE(channels(out) == std::vector<int>{5, 9, 9, 9, 9, 5, 9, 9, 9, 9});
+    }
+
+    SECTION("frames larger than the quantum wait for enough credit")
+    {
+        SendScheduler scheduler(50, 1 << 20, 1 << 19);
+        queue(scheduler, 5, Bulk, 96);
+        queue(scheduler, 9, Bulk, 46);
+        queue(scheduler, 9, Bulk, 46);
+
+        QByteArray out;
+        scheduler.take(scheduler.queuedBytes(), out);
+        REQUIRE(channels(out) == std::vector<int>{9, 5, 9});
+    }
+}
+
+TEST_CASE(  "SendScheduler drops aborted frames",
+            "[libtego][protocol][scheduler]")
+{
+    SendScheduler scheduler(SendScheduler::FrameMaxSize, 1 << 20, 1 << 19);
+
+    queue(scheduler, 3, Chat, 10);
+    REQUIRE(scheduler.abortFrame(3, 10));
+    REQUIRE_FALSE(scheduler.contains(3));
+    REQUIRE(scheduler.queuedBytes() == 0);
+    REQUIRE_FALSE(scheduler.abortFrame(3, 10));
+
+    queue(scheduler, 3, Chat, 10, 'a');
+    queue(scheduler, 3, Chat, 20, 'b');
+    REQUIRE_FALSE(scheduler.abortFrame(3, 100));
+    REQUIRE(scheduler.abortFrame(3, 20));
+    REQUIRE(scheduler.queuedBytes() == 14);
+
+    QByteArray out;
+    scheduler.take(scheduler.queuedBytes(), out);
+    REQUIRE(out.size() == 14);
+    REQUIRE(out.mid(4) == QByteArray(10, 'a'));
+}
+
+TEST_CASE(  "SendScheduler tells bulk producers to stop and resume with hysteresis",
+            "[libtego][protocol][scheduler]")
+{
+    SendScheduler scheduler(SendScheduler::FrameMaxSize, 1000, 500);
+
+    queue(scheduler, 7, Bulk, 596);
+    REQUIRE_FALSE(scheduler.isFull(0));
+    // nothing to report before anyone was told to stop
+    REQUIRE_FALSE(scheduler.takeDrained(0));
+
+    // bytes the socket still holds count towards the backlog
+    REQUIRE(scheduler.isFull(400));
+
+    queue(scheduler, 7, Bulk, 396);
+    REQUIRE(scheduler.isFull(0));
+
+    // below the high water mark but not yet below the low one
+    QByteArray out;
+    scheduler.take(1, out);
+    REQUIRE(scheduler.queuedBytes() == 400);
+    REQUIRE_FALSE(scheduler.isFull(100));
+    REQUIRE_FALSE(scheduler.takeDrained(100));
+
+    // drained is reported once
+    REQUIRE(scheduler.takeDrained(99));
+    REQUIRE_FALSE(scheduler.takeDrained(0));
+
+    // clearing forgets that anyone was told to stop
+    REQUIRE(scheduler.isFull(600));
+    scheduler.clear();
+    REQUIRE(scheduler.queuedBytes() == 0);
+    REQUIRE_FALSE(scheduler.takeDrained(0));
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch.hpp>
+
+#include <QList>
+#include <QString>
+
+#include <random>
+#include <unordered_map>
+
+#include "core/ServiceIdKey.h"
+
+namespace
+{
+    QString randomServiceId(std::mt19937 &rng)
+    {
+        static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+        QString id;
+        id.reserve(TEGO_V3_ONION_SERVICE_ID_LENGTH);
+        for (int i = 0; i < TEGO_V3_ONION_SERVICE_ID_LENGTH; ++i)
+        {
+            id.append(QLatin1Char(alphabet[rng() % 32]));
+        }
+        return id;
+    }
+}
+
+TEST_CASE(  "ServiceIdKey accepts every form of a contact's id",
+            "[libtego][contacts]")
+{
+    const QString id = QStringLiteral("rfwqyifl2w3ueoemxwexbyu3sl2qpfevmhcuptl5d5hm6yakzipfwxad");
+
+    ServiceIdKey bare, onion, contactId, upper;
+    REQUIRE(ServiceIdKey::fromHostname(id, bare));
+    REQUIRE(ServiceIdKey::fromHostname(id + QStringLiteral(".onion"), onion));
+    REQUIRE(ServiceIdKey::fromHostname(QStringLiteral("ricochet:") + id, contactId));
+    REQUIRE(ServiceIdKey::fromHostname(id.toUpper() + QStringLiteral(".ONION"), upper));
+    REQUIRE(bare.view() == id.toStdString());
+    REQUIRE(bare == onion);
+    REQUIRE(bare == contactId);
+    REQUIRE(bare == upper);
+
+    ServiceIdKey key;
+    REQUIRE_FALSE(ServiceIdKey::fromHostname(id.left(55) + QStringLiteral(".onion"), key));
+    REQUIRE_FALSE(ServiceIdKey::fromHostname(QString(), key));
+    REQUIRE_FALSE(ServiceIdKey::fromHostname(id.left(55) + QChar(0x00e9), key));
+}
+
+TEST_CASE(  "ServiceIdKey reads the UTF-8 hostnames of contact requests",
+            "[libtego][contacts]")
+{
+    const QByteArray id("rfwqyifl2w3ueoemxwexbyu3sl2qpfevmhcuptl5d5hm6yakzipfwxad");
+
+    ServiceIdKey fromString, bare, onion, upper;
+    REQUIRE(ServiceIdKey::fromHostname(QString::fromLatin1(id), fromString));
+    REQUIRE(ServiceIdKey::fromHostname(id, bare));
+    REQUIRE(ServiceIdKey::fromHostname(id + ".onion", onion));
+    REQUIRE(ServiceIdKey::fromHostname(id.toUpper() + ".ONION", upper));
+    REQUIRE(bare == fromString);
+    REQUIRE(bare == onion);
+    REQUIRE(bare == upper);
+
+    ServiceIdKey key;
+    REQUIRE_FALSE(ServiceIdKey::fromHostname(id.left(55) + ".onion", key));
+    REQUIRE_FALSE(ServiceIdKey::fromHostname(QByteArray(), key));
+    REQUIRE_FALSE(ServiceIdKey::fromHostname(id.left(54) + "\xc3\xa9", key));
+}
+
+TEST_CASE(  "Contact lookup by service id with large contact lists",
+            "[libtego][contacts][!benchmark]")
+{
+    for (const int contactCount : {10000, 100000})
+    {
+        std::mt19937 rng(static_cast<std::mt19937::result_type>(contactCount));
+
+        // what ContactsManager keeps, and what lookupHostname used to scan
+        std::unordered_map<ServiceIdKey, int, ServiceIdKey::Hash> index;
+        QList<QString> hostnames;
+        for (int i = 0; i < contactCount; ++i)
+        {
+            const QString hostname = randomServiceId(rng) + QStringLiteral(".onion");
+            ServiceIdKey key;
+            REQUIRE(ServiceIdKey::fromHostname(hostname, key));
+            index.emplace(key, i);
+            hostnames.append(hostname);
+        }
+
+        // a spread of contacts to look for, as an incoming connection would
+        QList<QString> wanted;
+        for (int i = 0; i < 100; ++i)
+        {
+            wanted.append(QStringLiteral("ricochet:") + hostnames[static_cast<int>(rng() % contactCount)].chopped(6));
+        }
+
+        BENCHMARK(QStringLiteral("hash index, %1 contacts").arg(contactCount).toStdString())
+        {
+            int found = 0;
+            for (const auto &id : wanted)
+            {
+                ServiceIdKey key;
+                found += ServiceIdKey::fromHostname(id, key) && index.count(key) != 0;
+            }
+            return found;
+        };
+
+        BENCHMARK(QStringLiteral("linear scan, %1 contacts").arg(contactCount).toStdString())
+        {
+            int found = 0;
+            for (const auto &id : wanted)
+            {
+                const QString ohost = id.mid(9) + QStringLiteral(".onion");
+                for (const auto &hostname : hostnames)
+                {
+                    if (ohost.compare(hostname, Qt::CaseInsensitive) == 0)
+                    {
+                        ++found;
+                        break;
+                    }
+                }
+            }
+            return found;
+        };
+    }
+}
@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include "tor/TorControlReply.h"
+
+using namespace Tor;
+
+TEST_CASE(  "Tor control reply lines are parsed in place",
+            "[libtego][tor][control]")
+{
+    TorControlReplyLine reply;
+
+    const std::string_view final = "250 OK";
+    REQUIRE(TorControlReplyLine::parse(final, reply));
+    REQUIRE(reply.statusCode == 250);
+    REQUIRE(reply.isFinal());
+    REQUIRE_FALSE(reply.isEvent());
+    REQUIRE(reply.data == "OK");
+    // the data is a view into the line, not a copy
+    REQUIRE(reply.data.data() == final.data() + 4);
+
+    REQUIRE(TorControlReplyLine::parse("250+onions/current=", reply));
+    REQUIRE(reply.startsData());
+    REQUIRE_FALSE(reply.isFinal());
+
+    REQUIRE(TorControlReplyLine::parse("650 STATUS_CLIENT NOTICE CIRCUIT_ESTABLISHED", reply));
+    REQUIRE(reply.isEvent());
+    REQUIRE(reply.eventName() == "STATUS_CLIENT");
+
+    REQUIRE(TorControlReplyLine::parse("650-HS_DESC", reply));
+    REQUIRE(reply.eventName() == "HS_DESC");
+
+    REQUIRE_FALSE(TorControlReplyLine::parse("250", reply));
+    REQUIRE_FALSE(TorControlReplyLine::parse("25a OK", reply));
+    REQUIRE_FALSE(TorControlReplyLine::parse("250*OK", reply));
+}
+
+TEST_CASE(  "Tor control line buffer splits pipelined replies across reads",
+            "[libtego][tor][control]")
+{
+    TorControlLineBuffer buffer;
+    std::string_view line;
+
+    // replies to three pipelined commands and an event, cut at awkward places
+    buffer.append("250 OK\r\n250-version=0.4.8.9\r");
+    REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::Line);
+    REQUIRE(line == "250 OK");
+    REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::NeedMore);
+
+    buffer.append("\n250 OK\r\n650 STATUS_CLIENT NOTICE");
+    REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::Line);
+    REQUIRE(line == "250-version=0.4.8.9");
+    REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::Line);
+    REQUIRE(line == "250 OK");
+    REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::NeedMore);
+
+    buffer.append(" BOOTSTRAP\r\n");
+    REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::Line);
+    REQUIRE(line == "650 STATUS_CLIENT NOTICE BOOTSTRAP");
+    REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::NeedMore);
+
+    SECTION("lines must end in CRLF")
+    {
+        buffer.append("250 OK\n");
+        REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::Invalid);
+    }
+
+    SECTION("lines may not grow without bound")
+    {
+        buffer.append(QByteArray(TorControlLineBuffer::MaxLineLength, 'x'));
+        REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::NeedMore);
+        buffer.append("xx");
+        REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::Invalid);
+    }
+
+    SECTION("clearing drops a partial line")
+    {
+        buffer.append("250-partial");
+        buffer.clear();
+        buffer.append("250 OK\r\n");
+        REQUIRE(buffer.next(line) == TorControlLineBuffer::Result::Line);
+        REQUIRE(line == "250 OK");
+    }
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+#include "tor/TorLogBuffer.h"
+
+using namespace Tor;
+
+namespace
+{
+    std::vector<std::string> readAll(const TorLogBuffer &logs, uint64_t &cursor)
+    {
+        std::vector<std::string> lines;
+        cursor = logs.readSince(cursor, [&](uint64_t, std::string_view line)
+        {
+            lines.emplace_back(line);
+            return true;
+        });
+        return lines;
+    }
+}
+
+TEST_CASE(  "TorLogBuffer keeps only the most recent messages",
+            "[libtego][tor][logs]")
+{
+    TorLogBuffer logs(3);
+    REQUIRE(logs.size() == 0);
+    REQUIRE(logs.firstSequence() == 1);
+    REQUIRE(logs.nextSequence() == 1);
+
+    REQUIRE(logs.append("one") == 1);
+    REQUIRE(logs.append("two") == 2);
+    REQUIRE(logs.append("three") == 3);
+    REQUIRE(logs.byteSize() == 11);
+
+    REQUIRE(logs.append("four") == 4);
+    REQUIRE(logs.size() == 3);
+    REQUIRE(logs.capacity() == 3);
+    REQUIRE(logs.firstSequence() == 2);
+    REQUIRE(logs.byteSize() == 12);
+
+    uint64_t cursor = 0;
+    REQUIRE(readAll(logs, cursor) == std::vector<std::string>{"two", "three", "four"});
+    REQUIRE(cursor == 5);
+}
+
+TEST_CASE(  "TorLogBuffer readers only see messages after their cursor",
+            "[libtego][tor][logs]")
+{
+    TorLogBuffer logs(4);
+    uint64_t cursor = 0;
+    REQUIRE(readAll(logs, cursor).empty());
+    REQUIRE(cursor == 1);
+
+    logs.append("one");
+    logs.append("two");
+    REQUIRE(readAll(logs, cursor) == std::vector<std::string>{"one", "two"});
+    REQUIRE(readAll(logs, cursor).empty());
+
+    // the reader falls behind: "three" and "four" are dropped before it reads
+    for (const char *line : {"three", "four", "five", "six", "seven", "eight"})
+        logs.append(line);
+    REQUIRE(readAll(logs, cursor) == std::vector<std::string>{"five", "six", "seven", "eight"});
+    REQUIRE(cursor == logs.nextSequence());
+}
+
+TEST_CASE(  "TorLogBuffer readers can stop early and resume",
+            "[libtego][tor][logs]")
+{
+    TorLogBuffer logs(8);
+    for (const char *line : {"a", "b", "c", "d"})
+        logs.append(line);
+
+    std::vector<uint64_t> seen;
+    uint64_t cursor = logs.readSince(0, [&](uint64_t sequence, std::string_view)
+    {
+        if (seen.size() == 2)
+            return false;
+        seen.push_back(sequence);
+        return true;
+    });
+    REQUIRE(seen == std::vector<uint64_t>{1, 2});
+    REQUIRE(cursor == 3);
+
+    REQUIRE(readAll(logs, cursor) == std::vector<std::string>{"c", "d"});
+}
+
+TEST_CASE(  "TorLogBuffer hands out views of the stored text",
+            "[libtego][tor][logs]")
+{
+    TorLogBuffer logs(2);
+    logs.append("first message");
+
+    const char *first = nullptr;
+    logs.readSince(0, [&](uint64_t, std::string_view line)
+    {
+        first = line.data();
+        return true;
+    });
+
+    // a shorter message reuses the slot in place once the buffer wraps
+    logs.append("second");
+    logs.append("third");
+    const char *third = nullptr;
+    logs.readSince(3, [&](uint64_t, std::string_view line)
+    {
+        third = line.data();
+        return true;
+    });
+    REQUIRE(third == first);
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+
+#include <QObject>
+#include <QVector>
+
+#include "tor/TorSocketScheduler.h"
+
+using namespace Tor;
+
+TEST_CASE(  "TorSocketScheduler caps concurrent attempts and starts by priority",
+            "[libtego][tor][scheduler]")
+{
+    TorSocketScheduler scheduler(2);
+    QObject a, b, c, d;
+    QVector<QObject*> started;
+    auto starter = [&](QObject *owner) { return [&started, owner]() { started.append(owner); }; };
+
+    scheduler.request(&a, 0, starter(&a));
+    scheduler.request(&b, 0, starter(&b));
+    scheduler.request(&c, 10, starter(&c));
+    scheduler.request(&d, 20, starter(&d));
+
+    // the first two got slots right away, the others wait
+    REQUIRE(started == QVector<QObject*>{&a, &b});
+    REQUIRE(scheduler.isWaiting(&c));
+    REQUIRE(scheduler.stats().active == 2);
+    REQUIRE(scheduler.stats().waiting == 2);
+
+    // asking again while connecting doesn't start a second attempt
+    scheduler.request(&a, 100, starter(&a));
+    REQUIRE(started.size() == 2);
+
+    // the most recently active contact goes next
+    scheduler.finished(&a, false);
+    REQUIRE(started.last() == &d);
+
+    // a cancelled request never starts
+    scheduler.cancel(&c);
+    scheduler.finished(&b, true);
+    scheduler.finished(&d, true);
+    REQUIRE(started == QVector<QObject*>{&a, &b, &d});
+
+    const auto stats = scheduler.stats();
+    REQUIRE(stats.active == 0);
+    REQUIRE(stats.waiting == 0);
+    REQUIRE(stats.started == 3);
+    REQUIRE(stats.succeeded == 2);
+    REQUIRE(stats.failed == 1);
+}
+
+TEST_CASE(  "TorSocketScheduler tolerates attempts that end as they start",
+            "[libtego][tor][scheduler]")
+{
+    TorSocketScheduler scheduler(1);
+    QObject a, b;
+    int starts = 0;
+
+    scheduler.request(&b, 0, [&]() { ++starts; });
+    scheduler.finished(&b, true);
+
+    // a failing start frees its slot from inside the scheduler
+    scheduler.request(&a, 0, [&]() { ++starts; scheduler.finished(&a, false); });
+    scheduler.request(&b, 0, [&]() { ++starts; });
+    REQUIRE(starts == 3);
+    REQUIRE(scheduler.isActive(&b));
+}
+
+TEST_CASE(  "TorSocketScheduler backoff is jittered and bounded",
+            "[libtego][tor][scheduler]")
+{
+    int delay = 0;
+    bool varied = false;
+    for (int i = 0; i < 200; ++i) {
+        const int next = TorSocketScheduler::nextBackoff(delay, 15, 600);
+        REQUIRE(next >= 15);
+        REQUIRE(next <= 600);
+        REQUIRE(next <= qMax(15, delay) * 3);
+        varied = varied || (i > 0 && next != delay);
+        delay = next;
+    }
+    REQUIRE(varied);
+}
@@ -461,6 +461,26 @@ namespace
         });
     }
 
+    void on_file_transfer_hashed(
+        tego_context_t*,
+        tego_user_id_t const* receiver,
+        tego_file_transfer_id_t id,
+        tego_file_hash_t const* fileHash)
+    {
+        auto contactId = tegoUserIdToContactId(receiver);
+        auto hashStr = tego::to_string(fileHash);
+
+        push_task([=]() -> void
+        {
+            auto contactUser = contactUserFromContactId(contactId);
+            Q_ASSERT(contactUser != nullptr);
+            auto conversationModel = contactUser->conversation();
+            Q_ASSERT(conversationModel != nullptr);
+
+            conversationModel->fileTransferHashed(id, QString::fromStdString(hashStr));
+        });
+    }
+
     void on_file_transfer_request_acknowledged(
         tego_context_t*,
         tego_user_id_t const* receiver,
@@ -634,6 +654,11 @@ void init_libtego_callbacks(tego_context_t* context)
         &on_file_transfer_request_received,
         tego::throw_on_error());
 
+    tego_context_set_file_transfer_hashed_callback(
+        context,
+        &on_file_transfer_hashed,
+        tego::throw_on_error());
+
     tego_context_set_file_transfer_request_acknowledged_callback(
         context,
         &on_file_transfer_request_acknowledged,
@@ -231,7 +231,6 @@ namespace shims
             const auto path = filePath.toUtf8();
             const auto userId = this->contactUser->toTegoUserId();
             tego_file_transfer_id_t id;
-            std::unique_ptr<tego_file_hash_t> fileHash;
             tego_file_size_t fileSize = 0;
 
             try
@@ -242,11 +241,11 @@ namespace shims
                     path.data(),
                     static_cast<size_t>(path.size()),
                     &id,
-                    tego::out(fileHash),
+                    nullptr, // hashed off the event loop, see fileTransferHashed
                     &fileSize,
                     tego::throw_on_error());
 
-                logger::println("send file request id : {}, hash : {}", id, tego::to_string(fileHash.get()));
+                logger::println("send file request id : {}", id);
 
                 MessageData md;
                 md.type = TransferMessage;
@@ -256,7 +255,6 @@ namespace shims
 
                 md.fileName = QFileInfo(filePath).fileName();
                 md.fileSize = safe_cast<qint64>(fileSize);
-                md.fileHash = QString::fromStdString(tego::to_string(fileHash.get()));
                 md.transferStatus = Pending;
                 md.transferDirection = Uploading;
 
@@ -563,6 +561,18 @@ namespace shims
         this->addEventFromMessage(indexOfIncomingMessage(id));
     }
 
+    void ConversationModel::fileTransferHashed(tego_file_transfer_id_t id, QString fileHash)
+    {
+        // the transfer may have been cleared from the conversation already
+        auto row = this->indexOfOutgoingMessage(id);
+        if (row < 0)
+            return;
+
+        MessageData &data = messages[row];
+        data.fileHash = std::move(fileHash);
+        emitDataChanged(row);
+    }
+
     void ConversationModel::fileTransferRequestAcknowledged(tego_file_transfer_id_t id, bool accepted)
     {
         auto row = this->indexOfOutgoingMessage(id);
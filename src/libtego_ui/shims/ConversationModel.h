@@ -103,6 +103,7 @@ namespace shims
         void setStatus(ContactUser::Status status);
 
         void fileTransferRequestReceived(tego_file_transfer_id_t id, QString fileName, QString fileHash, quint64 fileSize);
+        void fileTransferHashed(tego_file_transfer_id_t id, QString fileHash);
         void fileTransferRequestAcknowledged(tego_file_transfer_id_t id, bool accepted);
         void fileTransferRequestResponded(tego_file_transfer_id_t id, tego_file_transfer_response_t response);
         void fileTransferRequestProgressUpdated(tego_file_transfer_id_t id, quint64 bytesTransferred);
@@ -44,6 +44,13 @@ class SettingsObjectPrivate;
  *
  * Data is accessed via SettingsObject, either using the root property
  * or by creating a SettingsObject, optionally using a base path.
+ *
+ * Changes are not saved as they are made. The file is rewritten once no
+ * change has been made for syncDelay milliseconds, and at most maxSyncDelay
+ * milliseconds after the first unsaved change, so a burst of writes (such
+ * as importing contacts) costs a single save. Pending changes are also
+ * saved by sync(), before switching to another file path, and when the
+ * SettingsFile is destroyed.
  */
 class SettingsFile : public QObject
 {
@@ -68,6 +75,17 @@ public:
     SettingsObject *root();
     const SettingsObject *root() const;
 
+    int syncDelay() const;
+    void setSyncDelay(int msec);
+    int maxSyncDelay() const;
+    void setMaxSyncDelay(int msec);
+
+    bool hasPendingChanges() const;
+
+public slots:
+    /* Save pending changes now; returns false if they could not be written */
+    bool sync();
+
 signals:
     void filePathChanged();
     void error();